@@ -363,15 +363,470 @@ static int alloc_buffers(AVCodecContext *avctx)
     return 0;
 }
 
+/* inverse transform of a plane, for transform type 0 */
+static int reconstruct_plane(AVCodecContext *avctx, void *arg,
+                             int plane, int threadnr)
+{
+    CFHDContext *s = avctx->priv_data;
+    CFHDDSPContext *dsp = &s->dsp;
+    AVFrame *pic = arg;
+    /* level 1 */
+    int lowpass_height  = s->plane[plane].band[0][0].height;
+    int output_stride   = s->plane[plane].band[0][0].a_width;
+    int lowpass_width   = s->plane[plane].band[0][0].width;
+    int highpass_stride = s->plane[plane].band[0][1].stride;
+    int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
+    ptrdiff_t dst_linesize;
+    int16_t *low, *high, *output, *dst;
+    int i, j;
+
+    if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
+        act_plane = 0;
+        dst_linesize = pic->linesize[act_plane];
+    } else {
+        dst_linesize = pic->linesize[act_plane] / 2;
+    }
+
+    if (lowpass_height > s->plane[plane].band[0][0].a_height || lowpass_width > s->plane[plane].band[0][0].a_width ||
+        !highpass_stride || s->plane[plane].band[0][1].width > s->plane[plane].band[0][1].a_width ||
+        lowpass_width < 3 || lowpass_height < 3) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = s->plane[plane].subband[0];
+    high   = s->plane[plane].subband[2];
+    output = s->plane[plane].l_h[0];
+    dsp->vert_filter(output, output_stride, low, lowpass_width, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].subband[1];
+    high   = s->plane[plane].subband[3];
+    output = s->plane[plane].l_h[1];
+
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].l_h[0];
+    high   = s->plane[plane].l_h[1];
+    output = s->plane[plane].subband[0];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+    if (s->bpc == 12) {
+        output = s->plane[plane].subband[0];
+        for (i = 0; i < lowpass_height * 2; i++) {
+            for (j = 0; j < lowpass_width * 2; j++)
+                output[j] *= 4;
+
+            output += output_stride * 2;
+        }
+    }
+
+    /* level 2 */
+    lowpass_height  = s->plane[plane].band[1][1].height;
+    output_stride   = s->plane[plane].band[1][1].a_width;
+    lowpass_width   = s->plane[plane].band[1][1].width;
+    highpass_stride = s->plane[plane].band[1][1].stride;
+
+    if (lowpass_height > s->plane[plane].band[1][1].a_height || lowpass_width > s->plane[plane].band[1][1].a_width ||
+        !highpass_stride || s->plane[plane].band[1][1].width > s->plane[plane].band[1][1].a_width ||
+        lowpass_width < 3 || lowpass_height < 3) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Level 2 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = s->plane[plane].subband[0];
+    high   = s->plane[plane].subband[5];
+    output = s->plane[plane].l_h[3];
+    dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].subband[4];
+    high   = s->plane[plane].subband[6];
+    output = s->plane[plane].l_h[4];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].l_h[3];
+    high   = s->plane[plane].l_h[4];
+    output = s->plane[plane].subband[0];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+
+    output = s->plane[plane].subband[0];
+    for (i = 0; i < lowpass_height * 2; i++) {
+        for (j = 0; j < lowpass_width * 2; j++)
+            output[j] *= 4;
+
+        output += output_stride * 2;
+    }
+
+    /* level 3 */
+    lowpass_height  = s->plane[plane].band[2][1].height;
+    output_stride   = s->plane[plane].band[2][1].a_width;
+    lowpass_width   = s->plane[plane].band[2][1].width;
+    highpass_stride = s->plane[plane].band[2][1].stride;
+
+    if (lowpass_height > s->plane[plane].band[2][1].a_height || lowpass_width > s->plane[plane].band[2][1].a_width ||
+        !highpass_stride || s->plane[plane].band[2][1].width > s->plane[plane].band[2][1].a_width ||
+        lowpass_height < 3 || lowpass_width < 3 || lowpass_width * 2 > s->plane[plane].width) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Level 3 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+    if (s->progressive) {
+        low    = s->plane[plane].subband[0];
+        high   = s->plane[plane].subband[8];
+        output = s->plane[plane].l_h[6];
+        dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = s->plane[plane].subband[7];
+        high   = s->plane[plane].subband[9];
+        output = s->plane[plane].l_h[7];
+        dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        dst = (int16_t *)pic->data[act_plane];
+        if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
+            if (plane & 1)
+                dst++;
+            if (plane > 1)
+                dst += pic->linesize[act_plane] >> 1;
+        }
+        low  = s->plane[plane].l_h[6];
+        high = s->plane[plane].l_h[7];
+
+        if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
+            (lowpass_height * 2 > avctx->coded_height / 2 ||
+             lowpass_width  * 2 > avctx->coded_width  / 2    )
+            ) {
+            return AVERROR_INVALIDDATA;
+        }
+
+        for (i = 0; i < s->plane[act_plane].height; i++) {
+            dsp->horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
+            if (avctx->pix_fmt == AV_PIX_FMT_GBRAP12 && act_plane == 3)
+                process_alpha(dst, lowpass_width * 2);
+            low  += output_stride;
+            high += output_stride;
+            dst  += dst_linesize;
+        }
+    } else {
+        low    = s->plane[plane].subband[0];
+        high   = s->plane[plane].subband[7];
+        output = s->plane[plane].l_h[6];
+        dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = s->plane[plane].subband[8];
+        high   = s->plane[plane].subband[9];
+        output = s->plane[plane].l_h[7];
+        dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        dst  = (int16_t *)pic->data[act_plane];
+        low  = s->plane[plane].l_h[6];
+        high = s->plane[plane].l_h[7];
+        for (i = 0; i < s->plane[act_plane].height / 2; i++) {
+            interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
+            low  += output_stride * 2;
+            high += output_stride * 2;
+            dst  += pic->linesize[act_plane];
+        }
+    }
+
+    return 0;
+}
+
+/* inverse transform of a plane of the first frame of a group, for transform type 2 */
+static int reconstruct_plane_3d(AVCodecContext *avctx, void *arg,
+                                int plane, int threadnr)
+{
+    CFHDContext *s = avctx->priv_data;
+    CFHDDSPContext *dsp = &s->dsp;
+    AVFrame *pic = arg;
+    int lowpass_height  = s->plane[plane].band[0][0].height;
+    int output_stride   = s->plane[plane].band[0][0].a_width;
+    int lowpass_width   = s->plane[plane].band[0][0].width;
+    int highpass_stride = s->plane[plane].band[0][1].stride;
+    int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
+    int16_t *low, *high, *output, *dst;
+    ptrdiff_t dst_linesize;
+    int i, j;
+
+    if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
+        act_plane = 0;
+        dst_linesize = pic->linesize[act_plane];
+    } else {
+        dst_linesize = pic->linesize[act_plane] / 2;
+    }
+
+    if (lowpass_height > s->plane[plane].band[0][0].a_height || lowpass_width > s->plane[plane].band[0][0].a_width ||
+        !highpass_stride || s->plane[plane].band[0][1].width > s->plane[plane].band[0][1].a_width ||
+        lowpass_width < 3 || lowpass_height < 3) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = s->plane[plane].subband[0];
+    high   = s->plane[plane].subband[2];
+    output = s->plane[plane].l_h[0];
+    dsp->vert_filter(output, output_stride, low, lowpass_width, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].subband[1];
+    high   = s->plane[plane].subband[3];
+    output = s->plane[plane].l_h[1];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].l_h[0];
+    high   = s->plane[plane].l_h[1];
+    output = s->plane[plane].l_h[7];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+    if (s->bpc == 12) {
+        output = s->plane[plane].l_h[7];
+        for (i = 0; i < lowpass_height * 2; i++) {
+            for (j = 0; j < lowpass_width * 2; j++)
+                output[j] *= 4;
+
+            output += output_stride * 2;
+        }
+    }
+
+    lowpass_height  = s->plane[plane].band[1][1].height;
+    output_stride   = s->plane[plane].band[1][1].a_width;
+    lowpass_width   = s->plane[plane].band[1][1].width;
+    highpass_stride = s->plane[plane].band[1][1].stride;
+
+    if (lowpass_height > s->plane[plane].band[1][1].a_height || lowpass_width > s->plane[plane].band[1][1].a_width ||
+        !highpass_stride || s->plane[plane].band[1][1].width > s->plane[plane].band[1][1].a_width ||
+        lowpass_width < 3 || lowpass_height < 3) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    av_log(avctx, AV_LOG_DEBUG, "Level 2 lowpass plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    low    = s->plane[plane].l_h[7];
+    high   = s->plane[plane].subband[5];
+    output = s->plane[plane].l_h[3];
+    dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].subband[4];
+    high   = s->plane[plane].subband[6];
+    output = s->plane[plane].l_h[4];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].l_h[3];
+    high   = s->plane[plane].l_h[4];
+    output = s->plane[plane].l_h[7];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+
+    output = s->plane[plane].l_h[7];
+    for (i = 0; i < lowpass_height * 2; i++) {
+        for (j = 0; j < lowpass_width * 2; j++)
+            output[j] *= 4;
+        output += output_stride * 2;
+    }
+
+    low    = s->plane[plane].subband[7];
+    high   = s->plane[plane].subband[9];
+    output = s->plane[plane].l_h[3];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].subband[8];
+    high   = s->plane[plane].subband[10];
+    output = s->plane[plane].l_h[4];
+    dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+    low    = s->plane[plane].l_h[3];
+    high   = s->plane[plane].l_h[4];
+    output = s->plane[plane].l_h[9];
+    dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
+
+    lowpass_height  = s->plane[plane].band[4][1].height;
+    output_stride   = s->plane[plane].band[4][1].a_width;
+    lowpass_width   = s->plane[plane].band[4][1].width;
+    highpass_stride = s->plane[plane].band[4][1].stride;
+    av_log(avctx, AV_LOG_DEBUG, "temporal level %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
+
+    if (lowpass_height > s->plane[plane].band[4][1].a_height || lowpass_width > s->plane[plane].band[4][1].a_width ||
+        !highpass_stride || s->plane[plane].band[4][1].width > s->plane[plane].band[4][1].a_width ||
+        lowpass_width < 3 || lowpass_height < 3) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    low    = s->plane[plane].l_h[7];
+    high   = s->plane[plane].l_h[9];
+    output = s->plane[plane].l_h[7];
+    for (i = 0; i < lowpass_height; i++) {
+        inverse_temporal_filter(low, high, lowpass_width);
+        low    += output_stride;
+        high   += output_stride;
+    }
+    if (s->progressive) {
+        low    = s->plane[plane].l_h[7];
+        high   = s->plane[plane].subband[15];
+        output = s->plane[plane].l_h[6];
+        dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = s->plane[plane].subband[14];
+        high   = s->plane[plane].subband[16];
+        output = s->plane[plane].l_h[7];
+        dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = s->plane[plane].l_h[9];
+        high   = s->plane[plane].subband[12];
+        output = s->plane[plane].l_h[8];
+        dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = s->plane[plane].subband[11];
+        high   = s->plane[plane].subband[13];
+        output = s->plane[plane].l_h[9];
+        dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        if (s->sample_type == 1)
+            return 0;
+
+        dst = (int16_t *)pic->data[act_plane];
+        if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
+            if (plane & 1)
+                dst++;
+            if (plane > 1)
+                dst += pic->linesize[act_plane] >> 1;
+        }
+
+        if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
+            (lowpass_height * 2 > avctx->coded_height / 2 ||
+             lowpass_width  * 2 > avctx->coded_width  / 2    )
+            ) {
+            return AVERROR_INVALIDDATA;
+        }
+
+        low  = s->plane[plane].l_h[6];
+        high = s->plane[plane].l_h[7];
+        for (i = 0; i < s->plane[act_plane].height; i++) {
+            dsp->horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
+            low  += output_stride;
+            high += output_stride;
+            dst  += dst_linesize;
+        }
+    } else {
+        low    = s->plane[plane].l_h[7];
+        high   = s->plane[plane].subband[14];
+        output = s->plane[plane].l_h[6];
+        dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = s->plane[plane].subband[15];
+        high   = s->plane[plane].subband[16];
+        output = s->plane[plane].l_h[7];
+        dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = s->plane[plane].l_h[9];
+        high   = s->plane[plane].subband[11];
+        output = s->plane[plane].l_h[8];
+        dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        low    = s->plane[plane].subband[12];
+        high   = s->plane[plane].subband[13];
+        output = s->plane[plane].l_h[9];
+        dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
+
+        if (s->sample_type == 1)
+            return 0;
+
+        dst  = (int16_t *)pic->data[act_plane];
+        low  = s->plane[plane].l_h[6];
+        high = s->plane[plane].l_h[7];
+        for (i = 0; i < s->plane[act_plane].height / 2; i++) {
+            interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
+            low  += output_stride * 2;
+            high += output_stride * 2;
+            dst  += pic->linesize[act_plane];
+        }
+    }
+
+    return 0;
+}
+
+/* output of a plane of the second frame of a group, for transform type 2 */
+static int output_plane_3d(AVCodecContext *avctx, void *arg,
+                           int plane, int threadnr)
+{
+    CFHDContext *s = avctx->priv_data;
+    CFHDDSPContext *dsp = &s->dsp;
+    AVFrame *pic = arg;
+    int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
+    int16_t *low, *high, *dst;
+    int output_stride, lowpass_height, lowpass_width;
+    ptrdiff_t dst_linesize;
+    int i;
+
+    if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
+        act_plane = 0;
+        dst_linesize = pic->linesize[act_plane];
+    } else {
+        dst_linesize = pic->linesize[act_plane] / 2;
+    }
+
+    lowpass_height  = s->plane[plane].band[4][1].height;
+    output_stride   = s->plane[plane].band[4][1].a_width;
+    lowpass_width   = s->plane[plane].band[4][1].width;
+
+    if (lowpass_height > s->plane[plane].band[4][1].a_height || lowpass_width > s->plane[plane].band[4][1].a_width ||
+        s->plane[plane].band[4][1].width > s->plane[plane].band[4][1].a_width ||
+        lowpass_width < 3 || lowpass_height < 3) {
+        av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
+        return AVERROR(EINVAL);
+    }
+
+    if (s->progressive) {
+        dst = (int16_t *)pic->data[act_plane];
+        low  = s->plane[plane].l_h[8];
+        high = s->plane[plane].l_h[9];
+
+        if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
+            if (plane & 1)
+                dst++;
+            if (plane > 1)
+                dst += pic->linesize[act_plane] >> 1;
+        }
+
+        if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
+            (lowpass_height * 2 > avctx->coded_height / 2 ||
+             lowpass_width  * 2 > avctx->coded_width  / 2    )
+            ) {
+            return AVERROR_INVALIDDATA;
+        }
+
+        for (i = 0; i < s->plane[act_plane].height; i++) {
+            dsp->horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
+            low  += output_stride;
+            high += output_stride;
+            dst  += dst_linesize;
+        }
+    } else {
+        dst  = (int16_t *)pic->data[act_plane];
+        low  = s->plane[plane].l_h[8];
+        high = s->plane[plane].l_h[9];
+        for (i = 0; i < s->plane[act_plane].height / 2; i++) {
+            interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
+            low  += output_stride * 2;
+            high += output_stride * 2;
+            dst  += pic->linesize[act_plane];
+        }
+    }
+
+    return 0;
+}
+
 static int cfhd_decode(AVCodecContext *avctx, void *data, int *got_frame,
                        AVPacket *avpkt)
 {
     CFHDContext *s = avctx->priv_data;
-    CFHDDSPContext *dsp = &s->dsp;
     GetByteContext gb;
     ThreadFrame frame = { .f = data };
     AVFrame *pic = data;
     int ret = 0, i, j, plane, got_buffer = 0;
+    int rets[4] = { 0 };
     int16_t *coeff_data;
 
     init_frame_defaults(s);
@@ -894,449 +1349,32 @@ finish:
         goto end;
     }
 
+    /* the planes are reconstructed independently, in parallel with slice threads */
     if (s->transform_type == 0 && s->sample_type != 1) {
-        for (plane = 0; plane < s->planes && !ret; plane++) {
-            /* level 1 */
-            int lowpass_height  = s->plane[plane].band[0][0].height;
-            int output_stride   = s->plane[plane].band[0][0].a_width;
-            int lowpass_width   = s->plane[plane].band[0][0].width;
-            int highpass_stride = s->plane[plane].band[0][1].stride;
-            int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
-            ptrdiff_t dst_linesize;
-            int16_t *low, *high, *output, *dst;
-
-            if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                act_plane = 0;
-                dst_linesize = pic->linesize[act_plane];
-            } else {
-                dst_linesize = pic->linesize[act_plane] / 2;
-            }
-
-            if (lowpass_height > s->plane[plane].band[0][0].a_height || lowpass_width > s->plane[plane].band[0][0].a_width ||
-                !highpass_stride || s->plane[plane].band[0][1].width > s->plane[plane].band[0][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            low    = s->plane[plane].subband[0];
-            high   = s->plane[plane].subband[2];
-            output = s->plane[plane].l_h[0];
-            dsp->vert_filter(output, output_stride, low, lowpass_width, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].subband[1];
-            high   = s->plane[plane].subband[3];
-            output = s->plane[plane].l_h[1];
-
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].l_h[0];
-            high   = s->plane[plane].l_h[1];
-            output = s->plane[plane].subband[0];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
-            if (s->bpc == 12) {
-                output = s->plane[plane].subband[0];
-                for (i = 0; i < lowpass_height * 2; i++) {
-                    for (j = 0; j < lowpass_width * 2; j++)
-                        output[j] *= 4;
-
-                    output += output_stride * 2;
-                }
-            }
-
-            /* level 2 */
-            lowpass_height  = s->plane[plane].band[1][1].height;
-            output_stride   = s->plane[plane].band[1][1].a_width;
-            lowpass_width   = s->plane[plane].band[1][1].width;
-            highpass_stride = s->plane[plane].band[1][1].stride;
-
-            if (lowpass_height > s->plane[plane].band[1][1].a_height || lowpass_width > s->plane[plane].band[1][1].a_width ||
-                !highpass_stride || s->plane[plane].band[1][1].width > s->plane[plane].band[1][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Level 2 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            low    = s->plane[plane].subband[0];
-            high   = s->plane[plane].subband[5];
-            output = s->plane[plane].l_h[3];
-            dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].subband[4];
-            high   = s->plane[plane].subband[6];
-            output = s->plane[plane].l_h[4];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].l_h[3];
-            high   = s->plane[plane].l_h[4];
-            output = s->plane[plane].subband[0];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
-
-            output = s->plane[plane].subband[0];
-            for (i = 0; i < lowpass_height * 2; i++) {
-                for (j = 0; j < lowpass_width * 2; j++)
-                    output[j] *= 4;
-
-                output += output_stride * 2;
-            }
-
-            /* level 3 */
-            lowpass_height  = s->plane[plane].band[2][1].height;
-            output_stride   = s->plane[plane].band[2][1].a_width;
-            lowpass_width   = s->plane[plane].band[2][1].width;
-            highpass_stride = s->plane[plane].band[2][1].stride;
-
-            if (lowpass_height > s->plane[plane].band[2][1].a_height || lowpass_width > s->plane[plane].band[2][1].a_width ||
-                !highpass_stride || s->plane[plane].band[2][1].width > s->plane[plane].band[2][1].a_width ||
-                lowpass_height < 3 || lowpass_width < 3 || lowpass_width * 2 > s->plane[plane].width) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Level 3 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-            if (s->progressive) {
-                low    = s->plane[plane].subband[0];
-                high   = s->plane[plane].subband[8];
-                output = s->plane[plane].l_h[6];
-                dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[7];
-                high   = s->plane[plane].subband[9];
-                output = s->plane[plane].l_h[7];
-                dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                dst = (int16_t *)pic->data[act_plane];
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                    if (plane & 1)
-                        dst++;
-                    if (plane > 1)
-                        dst += pic->linesize[act_plane] >> 1;
-                }
-                low  = s->plane[plane].l_h[6];
-                high = s->plane[plane].l_h[7];
-
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
-                    (lowpass_height * 2 > avctx->coded_height / 2 ||
-                     lowpass_width  * 2 > avctx->coded_width  / 2    )
-                    ) {
-                    ret = AVERROR_INVALIDDATA;
-                    goto end;
-                }
-
-                for (i = 0; i < s->plane[act_plane].height; i++) {
-                    dsp->horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
-                    if (avctx->pix_fmt == AV_PIX_FMT_GBRAP12 && act_plane == 3)
-                        process_alpha(dst, lowpass_width * 2);
-                    low  += output_stride;
-                    high += output_stride;
-                    dst  += dst_linesize;
-                }
-            } else {
-                av_log(avctx, AV_LOG_DEBUG, "interlaced frame ? %d", pic->interlaced_frame);
-                pic->interlaced_frame = 1;
-                low    = s->plane[plane].subband[0];
-                high   = s->plane[plane].subband[7];
-                output = s->plane[plane].l_h[6];
-                dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[8];
-                high   = s->plane[plane].subband[9];
-                output = s->plane[plane].l_h[7];
-                dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                dst  = (int16_t *)pic->data[act_plane];
-                low  = s->plane[plane].l_h[6];
-                high = s->plane[plane].l_h[7];
-                for (i = 0; i < s->plane[act_plane].height / 2; i++) {
-                    interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
-                    low  += output_stride * 2;
-                    high += output_stride * 2;
-                    dst  += pic->linesize[act_plane];
-                }
-            }
+        if (!s->progressive) {
+            av_log(avctx, AV_LOG_DEBUG, "interlaced frame ? %d", pic->interlaced_frame);
+            pic->interlaced_frame = 1;
         }
+        avctx->execute2(avctx, reconstruct_plane, pic, rets, s->planes);
     } else if (s->transform_type == 2 && (avctx->internal->is_copy || s->frame_index == 1 || s->sample_type != 1)) {
-        for (plane = 0; plane < s->planes && !ret; plane++) {
-            int lowpass_height  = s->plane[plane].band[0][0].height;
-            int output_stride   = s->plane[plane].band[0][0].a_width;
-            int lowpass_width   = s->plane[plane].band[0][0].width;
-            int highpass_stride = s->plane[plane].band[0][1].stride;
-            int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
-            int16_t *low, *high, *output, *dst;
-            ptrdiff_t dst_linesize;
-
-            if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                act_plane = 0;
-                dst_linesize = pic->linesize[act_plane];
-            } else {
-                dst_linesize = pic->linesize[act_plane] / 2;
-            }
-
-            if (lowpass_height > s->plane[plane].band[0][0].a_height || lowpass_width > s->plane[plane].band[0][0].a_width ||
-                !highpass_stride || s->plane[plane].band[0][1].width > s->plane[plane].band[0][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Decoding level 1 plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            low    = s->plane[plane].subband[0];
-            high   = s->plane[plane].subband[2];
-            output = s->plane[plane].l_h[0];
-            dsp->vert_filter(output, output_stride, low, lowpass_width, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].subband[1];
-            high   = s->plane[plane].subband[3];
-            output = s->plane[plane].l_h[1];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].l_h[0];
-            high   = s->plane[plane].l_h[1];
-            output = s->plane[plane].l_h[7];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
-            if (s->bpc == 12) {
-                output = s->plane[plane].l_h[7];
-                for (i = 0; i < lowpass_height * 2; i++) {
-                    for (j = 0; j < lowpass_width * 2; j++)
-                        output[j] *= 4;
-
-                    output += output_stride * 2;
-                }
-            }
-
-            lowpass_height  = s->plane[plane].band[1][1].height;
-            output_stride   = s->plane[plane].band[1][1].a_width;
-            lowpass_width   = s->plane[plane].band[1][1].width;
-            highpass_stride = s->plane[plane].band[1][1].stride;
-
-            if (lowpass_height > s->plane[plane].band[1][1].a_height || lowpass_width > s->plane[plane].band[1][1].a_width ||
-                !highpass_stride || s->plane[plane].band[1][1].width > s->plane[plane].band[1][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            av_log(avctx, AV_LOG_DEBUG, "Level 2 lowpass plane %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            low    = s->plane[plane].l_h[7];
-            high   = s->plane[plane].subband[5];
-            output = s->plane[plane].l_h[3];
-            dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].subband[4];
-            high   = s->plane[plane].subband[6];
-            output = s->plane[plane].l_h[4];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].l_h[3];
-            high   = s->plane[plane].l_h[4];
-            output = s->plane[plane].l_h[7];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
-
-            output = s->plane[plane].l_h[7];
-            for (i = 0; i < lowpass_height * 2; i++) {
-                for (j = 0; j < lowpass_width * 2; j++)
-                    output[j] *= 4;
-                output += output_stride * 2;
-            }
-
-            low    = s->plane[plane].subband[7];
-            high   = s->plane[plane].subband[9];
-            output = s->plane[plane].l_h[3];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].subband[8];
-            high   = s->plane[plane].subband[10];
-            output = s->plane[plane].l_h[4];
-            dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-            low    = s->plane[plane].l_h[3];
-            high   = s->plane[plane].l_h[4];
-            output = s->plane[plane].l_h[9];
-            dsp->horiz_filter(output, output_stride, low, output_stride, high, output_stride, lowpass_width, lowpass_height * 2);
-
-            lowpass_height  = s->plane[plane].band[4][1].height;
-            output_stride   = s->plane[plane].band[4][1].a_width;
-            lowpass_width   = s->plane[plane].band[4][1].width;
-            highpass_stride = s->plane[plane].band[4][1].stride;
-            av_log(avctx, AV_LOG_DEBUG, "temporal level %i %i %i %i\n", plane, lowpass_height, lowpass_width, highpass_stride);
-
-            if (lowpass_height > s->plane[plane].band[4][1].a_height || lowpass_width > s->plane[plane].band[4][1].a_width ||
-                !highpass_stride || s->plane[plane].band[4][1].width > s->plane[plane].band[4][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
-                goto end;
-            }
-
-            low    = s->plane[plane].l_h[7];
-            high   = s->plane[plane].l_h[9];
-            output = s->plane[plane].l_h[7];
-            for (i = 0; i < lowpass_height; i++) {
-                inverse_temporal_filter(low, high, lowpass_width);
-                low    += output_stride;
-                high   += output_stride;
-            }
-            if (s->progressive) {
-                low    = s->plane[plane].l_h[7];
-                high   = s->plane[plane].subband[15];
-                output = s->plane[plane].l_h[6];
-                dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[14];
-                high   = s->plane[plane].subband[16];
-                output = s->plane[plane].l_h[7];
-                dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].l_h[9];
-                high   = s->plane[plane].subband[12];
-                output = s->plane[plane].l_h[8];
-                dsp->vert_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[11];
-                high   = s->plane[plane].subband[13];
-                output = s->plane[plane].l_h[9];
-                dsp->vert_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                if (s->sample_type == 1)
-                    continue;
-
-                dst = (int16_t *)pic->data[act_plane];
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                    if (plane & 1)
-                        dst++;
-                    if (plane > 1)
-                        dst += pic->linesize[act_plane] >> 1;
-                }
-
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
-                    (lowpass_height * 2 > avctx->coded_height / 2 ||
-                     lowpass_width  * 2 > avctx->coded_width  / 2    )
-                    ) {
-                    ret = AVERROR_INVALIDDATA;
-                    goto end;
-                }
-
-                low  = s->plane[plane].l_h[6];
-                high = s->plane[plane].l_h[7];
-                for (i = 0; i < s->plane[act_plane].height; i++) {
-                    dsp->horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
-                    low  += output_stride;
-                    high += output_stride;
-                    dst  += dst_linesize;
-                }
-            } else {
-                pic->interlaced_frame = 1;
-                low    = s->plane[plane].l_h[7];
-                high   = s->plane[plane].subband[14];
-                output = s->plane[plane].l_h[6];
-                dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[15];
-                high   = s->plane[plane].subband[16];
-                output = s->plane[plane].l_h[7];
-                dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].l_h[9];
-                high   = s->plane[plane].subband[11];
-                output = s->plane[plane].l_h[8];
-                dsp->horiz_filter(output, output_stride, low, output_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                low    = s->plane[plane].subband[12];
-                high   = s->plane[plane].subband[13];
-                output = s->plane[plane].l_h[9];
-                dsp->horiz_filter(output, output_stride, low, highpass_stride, high, highpass_stride, lowpass_width, lowpass_height);
-
-                if (s->sample_type == 1)
-                    continue;
-
-                dst  = (int16_t *)pic->data[act_plane];
-                low  = s->plane[plane].l_h[6];
-                high = s->plane[plane].l_h[7];
-                for (i = 0; i < s->plane[act_plane].height / 2; i++) {
-                    interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
-                    low  += output_stride * 2;
-                    high += output_stride * 2;
-                    dst  += pic->linesize[act_plane];
-                }
-            }
+        if (!s->progressive)
+            pic->interlaced_frame = 1;
+        avctx->execute2(avctx, reconstruct_plane_3d, pic, rets, s->planes);
+    }
+    for (plane = 0; plane < s->planes; plane++) {
+        if (rets[plane] < 0) {
+            ret = rets[plane];
+            goto end;
         }
     }
 
     if (s->transform_type == 2 && s->sample_type == 1) {
-        int16_t *low, *high, *dst;
-        int output_stride, lowpass_height, lowpass_width;
-        ptrdiff_t dst_linesize;
-
+        avctx->execute2(avctx, output_plane_3d, pic, rets, s->planes);
         for (plane = 0; plane < s->planes; plane++) {
-            int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
-
-            if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                act_plane = 0;
-                dst_linesize = pic->linesize[act_plane];
-            } else {
-                dst_linesize = pic->linesize[act_plane] / 2;
-            }
-
-            lowpass_height  = s->plane[plane].band[4][1].height;
-            output_stride   = s->plane[plane].band[4][1].a_width;
-            lowpass_width   = s->plane[plane].band[4][1].width;
-
-            if (lowpass_height > s->plane[plane].band[4][1].a_height || lowpass_width > s->plane[plane].band[4][1].a_width ||
-                s->plane[plane].band[4][1].width > s->plane[plane].band[4][1].a_width ||
-                lowpass_width < 3 || lowpass_height < 3) {
-                av_log(avctx, AV_LOG_ERROR, "Invalid plane dimensions\n");
-                ret = AVERROR(EINVAL);
+            if (rets[plane] < 0) {
+                ret = rets[plane];
                 goto end;
             }
-
-            if (s->progressive) {
-                dst = (int16_t *)pic->data[act_plane];
-                low  = s->plane[plane].l_h[8];
-                high = s->plane[plane].l_h[9];
-
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16) {
-                    if (plane & 1)
-                        dst++;
-                    if (plane > 1)
-                        dst += pic->linesize[act_plane] >> 1;
-                }
-
-                if (avctx->pix_fmt == AV_PIX_FMT_BAYER_RGGB16 &&
-                    (lowpass_height * 2 > avctx->coded_height / 2 ||
-                     lowpass_width  * 2 > avctx->coded_width  / 2    )
-                    ) {
-                    ret = AVERROR_INVALIDDATA;
-                    goto end;
-                }
-
-                for (i = 0; i < s->plane[act_plane].height; i++) {
-                    dsp->horiz_filter_clip(dst, low, high, lowpass_width, s->bpc);
-                    low  += output_stride;
-                    high += output_stride;
-                    dst  += dst_linesize;
-                }
-            } else {
-                dst  = (int16_t *)pic->data[act_plane];
-                low  = s->plane[plane].l_h[8];
-                high = s->plane[plane].l_h[9];
-                for (i = 0; i < s->plane[act_plane].height / 2; i++) {
-                    interlaced_vertical_filter(dst, low, high, lowpass_width * 2,  pic->linesize[act_plane]/2, act_plane);
-                    low  += output_stride * 2;
-                    high += output_stride * 2;
-                    dst  += pic->linesize[act_plane];
-                }
-            }
         }
     }
 
@@ -1408,6 +1446,7 @@ AVCodec ff_cfhd_decoder = {
     .close            = cfhd_close,
     .decode           = cfhd_decode,
     .update_thread_context = ONLY_IF_THREADS_ENABLED(update_thread_context),
-    .capabilities     = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
+    .capabilities     = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                        AV_CODEC_CAP_SLICE_THREADS,
     .caps_internal    = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_INIT_CLEANUP,
 };
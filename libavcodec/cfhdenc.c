@@ -260,6 +260,13 @@ static av_cold int cfhd_encode_init(AVCodecContext *avctx)
         return AVERROR_INVALIDDATA;
     }
 
+    /* the filters of the smallest bands need 3 coefficient pairs */
+    if (avctx->width < 24 << s->chroma_h_shift || avctx->height < 17) {
+        av_log(avctx, AV_LOG_ERROR, "Width must be at least %d and height at least 17.\n",
+               24 << s->chroma_h_shift);
+        return AVERROR_INVALIDDATA;
+    }
+
     s->planes = av_pix_fmt_count_planes(avctx->pix_fmt);
 
     for (int i = 0; i < s->planes; i++) {
@@ -450,160 +457,169 @@ static void process_alpha(const int16_t *src, int width, int height, ptrdiff_t s
     }
 }
 
-static int cfhd_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
-                             const AVFrame *frame, int *got_packet)
+static int transform_plane(AVCodecContext *avctx, void *arg,
+                           int plane, int threadnr)
 {
     CFHDEncContext *s = avctx->priv_data;
-    PutByteContext *pby = &s->pby;
-    PutBitContext *pb = &s->pb;
-    const Codebook *const cb = s->cb;
-    const Runbook *const rb = s->rb;
-    const uint16_t *lut = s->lut;
-    unsigned pos;
-    int ret;
-
-    for (int plane = 0; plane < s->planes; plane++) {
-        int width = s->plane[plane].band[2][0].width;
-        int a_width = s->plane[plane].band[2][0].a_width;
-        int height = s->plane[plane].band[2][0].height;
-        int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
-        int16_t *input = (int16_t *)frame->data[act_plane];
-        int16_t *low = s->plane[plane].l_h[6];
-        int16_t *high = s->plane[plane].l_h[7];
-        ptrdiff_t in_stride = frame->linesize[act_plane] / 2;
-        int low_stride, high_stride;
-
-        if (plane == 3) {
-            process_alpha(input, avctx->width, avctx->height,
-                          in_stride, s->alpha);
-            input = s->alpha;
-            in_stride = avctx->width;
-        }
-
-        for (int i = 0; i < height * 2; i++) {
-            horiz_filter(input, low, high, width * 2);
-            input += in_stride;
-            low += a_width;
-            high += a_width;
-        }
+    const AVFrame *frame = arg;
+    int width = s->plane[plane].band[2][0].width;
+    int a_width = s->plane[plane].band[2][0].a_width;
+    int height = s->plane[plane].band[2][0].height;
+    int act_plane = plane == 1 ? 2 : plane == 2 ? 1 : plane;
+    int16_t *input = (int16_t *)frame->data[act_plane];
+    int16_t *low = s->plane[plane].l_h[6];
+    int16_t *high = s->plane[plane].l_h[7];
+    ptrdiff_t in_stride = frame->linesize[act_plane] / 2;
+    int low_stride, high_stride;
+
+    if (plane == 3) {
+        process_alpha(input, avctx->width, avctx->height,
+                      in_stride, s->alpha);
+        input = s->alpha;
+        in_stride = avctx->width;
+    }
 
-        input = s->plane[plane].l_h[7];
-        low = s->plane[plane].subband[7];
-        low_stride = s->plane[plane].band[2][0].a_width;
-        high = s->plane[plane].subband[9];
-        high_stride = s->plane[plane].band[2][0].a_width;
-
-        for (int i = 0; i < width; i++) {
-            vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
-            input++;
-            low++;
-            high++;
-        }
+    for (int i = 0; i < height * 2; i++) {
+        horiz_filter(input, low, high, width * 2);
+        input += in_stride;
+        low += a_width;
+        high += a_width;
+    }
 
-        input = s->plane[plane].l_h[6];
-        low = s->plane[plane].l_h[7];
-        high = s->plane[plane].subband[8];
+    input = s->plane[plane].l_h[7];
+    low = s->plane[plane].subband[7];
+    low_stride = s->plane[plane].band[2][0].a_width;
+    high = s->plane[plane].subband[9];
+    high_stride = s->plane[plane].band[2][0].a_width;
+
+    for (int i = 0; i < width; i++) {
+        vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
+        input++;
+        low++;
+        high++;
+    }
 
-        for (int i = 0; i < width; i++) {
-            vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
-            input++;
-            low++;
-            high++;
-        }
+    input = s->plane[plane].l_h[6];
+    low = s->plane[plane].l_h[7];
+    high = s->plane[plane].subband[8];
 
-        a_width = s->plane[plane].band[1][0].a_width;
-        width = s->plane[plane].band[1][0].width;
-        height = s->plane[plane].band[1][0].height;
-        input = s->plane[plane].l_h[7];
-        low = s->plane[plane].l_h[3];
-        low_stride = s->plane[plane].band[1][0].a_width;
-        high = s->plane[plane].l_h[4];
-        high_stride = s->plane[plane].band[1][0].a_width;
+    for (int i = 0; i < width; i++) {
+        vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
+        input++;
+        low++;
+        high++;
+    }
 
-        for (int i = 0; i < height * 2; i++) {
-            for (int j = 0; j < width * 2; j++)
-                input[j] /= 4;
-            input += a_width * 2;
-        }
+    a_width = s->plane[plane].band[1][0].a_width;
+    width = s->plane[plane].band[1][0].width;
+    height = s->plane[plane].band[1][0].height;
+    input = s->plane[plane].l_h[7];
+    low = s->plane[plane].l_h[3];
+    low_stride = s->plane[plane].band[1][0].a_width;
+    high = s->plane[plane].l_h[4];
+    high_stride = s->plane[plane].band[1][0].a_width;
+
+    for (int i = 0; i < height * 2; i++) {
+        for (int j = 0; j < width * 2; j++)
+            input[j] /= 4;
+        input += a_width * 2;
+    }
 
-        input = s->plane[plane].l_h[7];
-        for (int i = 0; i < height * 2; i++) {
-            horiz_filter(input, low, high, width * 2);
-            input += a_width * 2;
-            low += low_stride;
-            high += high_stride;
-        }
+    input = s->plane[plane].l_h[7];
+    for (int i = 0; i < height * 2; i++) {
+        horiz_filter(input, low, high, width * 2);
+        input += a_width * 2;
+        low += low_stride;
+        high += high_stride;
+    }
 
-        input = s->plane[plane].l_h[4];
-        low = s->plane[plane].subband[4];
-        high = s->plane[plane].subband[6];
+    input = s->plane[plane].l_h[4];
+    low = s->plane[plane].subband[4];
+    high = s->plane[plane].subband[6];
 
-        for (int i = 0; i < width; i++) {
-            vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
-            input++;
-            low++;
-            high++;
-        }
+    for (int i = 0; i < width; i++) {
+        vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
+        input++;
+        low++;
+        high++;
+    }
 
-        input = s->plane[plane].l_h[3];
-        low = s->plane[plane].l_h[4];
-        high = s->plane[plane].subband[5];
+    input = s->plane[plane].l_h[3];
+    low = s->plane[plane].l_h[4];
+    high = s->plane[plane].subband[5];
 
-        for (int i = 0; i < width; i++) {
-            vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
-            input++;
-            low++;
-            high++;
-        }
+    for (int i = 0; i < width; i++) {
+        vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
+        input++;
+        low++;
+        high++;
+    }
 
-        a_width = s->plane[plane].band[0][0].a_width;
-        width = s->plane[plane].band[0][0].width;
-        height = s->plane[plane].band[0][0].height;
-        input = s->plane[plane].l_h[4];
-        low = s->plane[plane].l_h[0];
-        low_stride = s->plane[plane].band[0][0].a_width;
-        high = s->plane[plane].l_h[1];
-        high_stride = s->plane[plane].band[0][0].a_width;
-
-        if (avctx->pix_fmt != AV_PIX_FMT_YUV422P10) {
-            for (int i = 0; i < height * 2; i++) {
-                for (int j = 0; j < width * 2; j++)
-                    input[j] /= 4;
-                input += a_width * 2;
-            }
-        }
+    a_width = s->plane[plane].band[0][0].a_width;
+    width = s->plane[plane].band[0][0].width;
+    height = s->plane[plane].band[0][0].height;
+    input = s->plane[plane].l_h[4];
+    low = s->plane[plane].l_h[0];
+    low_stride = s->plane[plane].band[0][0].a_width;
+    high = s->plane[plane].l_h[1];
+    high_stride = s->plane[plane].band[0][0].a_width;
 
-        input = s->plane[plane].l_h[4];
+    if (avctx->pix_fmt != AV_PIX_FMT_YUV422P10) {
         for (int i = 0; i < height * 2; i++) {
-            horiz_filter(input, low, high, width * 2);
+            for (int j = 0; j < width * 2; j++)
+                input[j] /= 4;
             input += a_width * 2;
-            low += low_stride;
-            high += high_stride;
         }
+    }
 
-        low = s->plane[plane].subband[1];
-        high = s->plane[plane].subband[3];
-        input = s->plane[plane].l_h[1];
+    input = s->plane[plane].l_h[4];
+    for (int i = 0; i < height * 2; i++) {
+        horiz_filter(input, low, high, width * 2);
+        input += a_width * 2;
+        low += low_stride;
+        high += high_stride;
+    }
 
-        for (int i = 0; i < width; i++) {
-            vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
-            input++;
-            low++;
-            high++;
-        }
+    low = s->plane[plane].subband[1];
+    high = s->plane[plane].subband[3];
+    input = s->plane[plane].l_h[1];
 
-        low = s->plane[plane].subband[0];
-        high = s->plane[plane].subband[2];
-        input = s->plane[plane].l_h[0];
+    for (int i = 0; i < width; i++) {
+        vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
+        input++;
+        low++;
+        high++;
+    }
 
-        for (int i = 0; i < width; i++) {
-            vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
-            input++;
-            low++;
-            high++;
-        }
+    low = s->plane[plane].subband[0];
+    high = s->plane[plane].subband[2];
+    input = s->plane[plane].l_h[0];
+
+    for (int i = 0; i < width; i++) {
+        vert_filter(input, a_width, low, low_stride, high, high_stride, height * 2);
+        input++;
+        low++;
+        high++;
     }
 
+    return 0;
+}
+
+static int cfhd_encode_frame(AVCodecContext *avctx, AVPacket *pkt,
+                             const AVFrame *frame, int *got_packet)
+{
+    CFHDEncContext *s = avctx->priv_data;
+    PutByteContext *pby = &s->pby;
+    PutBitContext *pb = &s->pb;
+    const Codebook *const cb = s->cb;
+    const Runbook *const rb = s->rb;
+    const uint16_t *lut = s->lut;
+    unsigned pos;
+    int ret;
+
+    /* the planes are transformed independently, in parallel with slice threads */
+    avctx->execute2(avctx, transform_plane, (void *)frame, NULL, s->planes);
+
     ret = ff_alloc_packet2(avctx, pkt, 64LL + s->planes * (2LL * avctx->width * avctx->height + 1000LL), 0);
     if (ret < 0)
         return ret;
@@ -912,7 +928,7 @@ AVCodec ff_cfhd_encoder = {
     .init             = cfhd_encode_init,
     .close            = cfhd_encode_close,
     .encode2          = cfhd_encode_frame,
-    .capabilities     = AV_CODEC_CAP_FRAME_THREADS,
+    .capabilities     = AV_CODEC_CAP_FRAME_THREADS | AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts         = (const enum AVPixelFormat[]) {
                           AV_PIX_FMT_YUV422P10,
                           AV_PIX_FMT_GBRP12,
@@ -35,6 +35,7 @@
 #include "pixblockdsp.h"
 #include "packet_internal.h"
 #include "profiles.h"
+#include "thread.h"
 #include "dnxhdenc.h"
 
 // The largest value that will not lead to overflow for 10-bit samples.
@@ -64,6 +65,9 @@ static const AVOption options[] = {
         0, 0, VE, "profile" },
     { "dnxhr_lb",  NULL, 0, AV_OPT_TYPE_CONST, { .i64 = FF_PROFILE_DNXHR_LB },
         0, 0, VE, "profile" },
+    { "slice_threads", "threads encoding the slices of each frame with frame threading",
+        offsetof(DNXHDEncContext, slice_threads), AV_OPT_TYPE_INT,
+        { .i64 = 1 }, 1, MAX_THREADS, VE },
     { NULL }
 };
 
@@ -512,6 +516,13 @@ FF_ENABLE_DEPRECATION_WARNINGS
             av_log(avctx, AV_LOG_ERROR, "too many threads\n");
             return AVERROR(EINVAL);
         }
+        ctx->nb_threads = avctx->thread_count;
+    } else {
+        /* run the slices of each frame thread in parallel if requested */
+        ret = ff_slice_thread_init_nested(avctx, ctx->slice_threads);
+        if (ret < 0)
+            return ret;
+        ctx->nb_threads = ret;
     }
 
     if (avctx->qmax <= 1) {
@@ -520,13 +531,11 @@ FF_ENABLE_DEPRECATION_WARNINGS
     }
 
     ctx->thread[0] = ctx;
-    if (avctx->active_thread_type == FF_THREAD_SLICE) {
-        for (i = 1; i < avctx->thread_count; i++) {
-            ctx->thread[i] = av_malloc(sizeof(DNXHDEncContext));
-            if (!ctx->thread[i])
-                return AVERROR(ENOMEM);
-            memcpy(ctx->thread[i], ctx, sizeof(DNXHDEncContext));
-        }
+    for (i = 1; i < ctx->nb_threads; i++) {
+        ctx->thread[i] = av_malloc(sizeof(DNXHDEncContext));
+        if (!ctx->thread[i])
+            return AVERROR(ENOMEM);
+        memcpy(ctx->thread[i], ctx, sizeof(DNXHDEncContext));
     }
 
     return 0;
@@ -1246,7 +1255,7 @@ static void dnxhd_load_picture(DNXHDEncContext *ctx, const AVFrame *frame)
 {
     int i;
 
-    for (i = 0; i < ctx->m.avctx->thread_count; i++) {
+    for (i = 0; i < ctx->nb_threads; i++) {
         ctx->thread[i]->m.linesize    = frame->linesize[0] << ctx->interlaced;
         ctx->thread[i]->m.uvlinesize  = frame->linesize[1] << ctx->interlaced;
         ctx->thread[i]->dct_y_offset  = ctx->m.linesize  *8;
@@ -1354,10 +1363,10 @@ static av_cold int dnxhd_encode_end(AVCodecContext *avctx)
     av_freep(&ctx->qmatrix_c16);
     av_freep(&ctx->qmatrix_l16);
 
-    if (avctx->active_thread_type == FF_THREAD_SLICE) {
-        for (i = 1; i < avctx->thread_count; i++)
-            av_freep(&ctx->thread[i]);
-    }
+    for (i = 1; i < ctx->nb_threads; i++)
+        av_freep(&ctx->thread[i]);
+
+    ff_slice_thread_free_nested(avctx);
 
     return 0;
 }
@@ -56,6 +56,8 @@ typedef struct DNXHDEncContext {
     uint32_t *slice_offs;
 
     struct DNXHDEncContext *thread[MAX_THREADS];
+    int nb_threads;         ///< number of used entries of thread
+    int slice_threads;
 
     // Because our samples are either 8 or 16 bits for 8-bit and 10-bit
     // encoding respectively, these refer either to bytes or to two-byte words.
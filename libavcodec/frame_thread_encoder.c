@@ -163,6 +163,16 @@ int ff_frame_thread_encoder_init(AVCodecContext *avctx, AVDictionary *options){
         }
     }
 
+    if (avctx->codec_id == AV_CODEC_ID_FFV1 &&
+        (avctx->gop_size > 1 || avctx->flags & AV_CODEC_FLAG_PASS1)) {
+        // the range coder states are carried over between the frames of a GOP
+        if (avctx->thread_count != 1)
+            av_log(avctx, AV_LOG_VERBOSE,
+                   "FFV1 frame multi-threading needs -g 1 and no first pass, "
+                   "using slice threads\n");
+        return 0;
+    }
+
     if(!avctx->thread_count) {
         avctx->thread_count = av_cpu_count();
         avctx->thread_count = FFMIN(avctx->thread_count, MAX_THREADS);
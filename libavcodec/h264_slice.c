@@ -2449,7 +2449,8 @@ static int fill_filter_caches(const H264Context *h, H264SliceContext *sl, int mb
     return 0;
 }
 
-static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x, int end_x)
+static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x, int end_x,
+                        int backup_border)
 {
     uint8_t *dest_y, *dest_cb, *dest_cr;
     int linesize, uvlinesize, mb_x, mb_y;
@@ -2496,8 +2497,9 @@ static void loop_filter(const H264Context *h, H264SliceContext *sl, int start_x,
                     linesize   = sl->mb_linesize   = sl->linesize;
                     uvlinesize = sl->mb_uvlinesize = sl->uvlinesize;
                 }
-                backup_mb_border(h, sl, dest_y, dest_cb, dest_cr, linesize,
-                                 uvlinesize, 0);
+                if (backup_border)
+                    backup_mb_border(h, sl, dest_y, dest_cb, dest_cr, linesize,
+                                     uvlinesize, 0);
                 if (fill_filter_caches(h, sl, mb_type))
                     continue;
                 sl->chroma_qp[0] = get_chroma_qp(h->ps.pps, 0, h->cur_pic.qscale_table[mb_xy]);
@@ -2577,10 +2579,209 @@ static void er_add_slice(H264SliceContext *sl,
     }
 }
 
-static int decode_slice(struct AVCodecContext *avctx, void *arg)
+typedef struct H264DeblockThread {
+#if HAVE_THREADS
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+#endif
+    /* copy of the slice context, so that the filter has its own caches */
+    H264SliceContext sl;
+    int active;         ///< the rows of a slice are being queued
+    int rows_decoded;   ///< end of the rows of the slice reconstructed so far
+    int rows_ready;     ///< end of the rows which can be filtered
+    int next_row;       ///< next row to filter
+    int exit;
+} H264DeblockThread;
+
+#if HAVE_THREADS
+/**
+ * Save the bottom line of the last MB row, before it is filtered, for the
+ * intra prediction of the next row, as loop_filter() does.
+ */
+static void backup_row_border(const H264Context *h, H264SliceContext *sl)
+{
+    const int pixel_shift = h->pixel_shift;
+    const int block_h     = 16 >> h->chroma_y_shift;
+    const int mb_y        = sl->mb_y;
+
+    for (sl->mb_x = 0; sl->mb_x < h->mb_width; sl->mb_x++) {
+        const int mb_x   = sl->mb_x;
+        uint8_t *dest_y  = h->cur_pic.f->data[0] +
+                           ((mb_x << pixel_shift) + mb_y * sl->linesize) * 16;
+        uint8_t *dest_cb = h->cur_pic.f->data[1] +
+                           (mb_x << pixel_shift) * (8 << CHROMA444(h)) +
+                           mb_y * sl->uvlinesize * block_h;
+        uint8_t *dest_cr = h->cur_pic.f->data[2] +
+                           (mb_x << pixel_shift) * (8 << CHROMA444(h)) +
+                           mb_y * sl->uvlinesize * block_h;
+
+        backup_mb_border(h, sl, dest_y, dest_cb, dest_cr, sl->linesize,
+                         sl->uvlinesize, 0);
+    }
+}
+
+static void *deblock_thread_worker(void *arg)
+{
+    H264DeblockThread *dt = arg;
+    H264SliceContext  *sl = &dt->sl;
+
+    pthread_mutex_lock(&dt->mutex);
+    while (!dt->exit) {
+        if (dt->next_row >= dt->rows_ready) {
+            pthread_cond_wait(&dt->cond, &dt->mutex);
+            continue;
+        }
+        sl->mb_y = dt->next_row;
+        pthread_mutex_unlock(&dt->mutex);
+
+        loop_filter(sl->h264, sl, 0, sl->h264->mb_width, 0);
+        decode_finish_row(sl->h264, sl);
+
+        pthread_mutex_lock(&dt->mutex);
+        dt->next_row++;
+        pthread_cond_broadcast(&dt->cond);
+    }
+    pthread_mutex_unlock(&dt->mutex);
+
+    return NULL;
+}
+
+/**
+ * Hand the rows of a slice over to the filter thread, if possible.
+ * Only progressive frames are handled, so that a row only reads the unfiltered
+ * bottom line of the previous one, through the saved borders.
+ *
+ * @return the filter thread, or NULL if the rows are to be filtered in place
+ */
+static H264DeblockThread *deblock_thread_start(const H264Context *h,
+                                               H264SliceContext *sl)
+{
+    H264DeblockThread *dt = h->deblock;
+
+    if (!dt || !sl->deblocking_filter || sl->is_complex ||
+        h->avctx->draw_horiz_band)
+        return NULL;
+
+    pthread_mutex_lock(&dt->mutex);
+    dt->sl = *sl;
+    /* a row started by a previous slice is filtered in place */
+    dt->next_row     =
+    dt->rows_ready   =
+    dt->rows_decoded = sl->mb_y + !!sl->mb_x;
+    dt->active       = 1;
+    pthread_mutex_unlock(&dt->mutex);
+
+    return dt;
+}
+
+static void deblock_thread_queue_row(H264DeblockThread *dt, const H264Context *h,
+                                     H264SliceContext *sl)
+{
+    backup_row_border(h, sl);
+
+    pthread_mutex_lock(&dt->mutex);
+    /* The intra prediction of the next row temporarily swaps the saved
+     * borders into the bottom line of this one, so it can only be filtered
+     * once the next row is reconstructed. */
+    dt->rows_ready   = sl->mb_y;
+    dt->rows_decoded = sl->mb_y + 1;
+    pthread_cond_broadcast(&dt->cond);
+    pthread_mutex_unlock(&dt->mutex);
+}
+
+/**
+ * Wait for all the reconstructed rows of the slice to be filtered.
+ */
+static void deblock_thread_flush(H264DeblockThread *dt)
+{
+    if (!dt || !dt->active)
+        return;
+
+    pthread_mutex_lock(&dt->mutex);
+    dt->rows_ready = dt->rows_decoded;
+    pthread_cond_broadcast(&dt->cond);
+    while (dt->next_row < dt->rows_ready)
+        pthread_cond_wait(&dt->cond, &dt->mutex);
+    dt->active = 0;
+    pthread_mutex_unlock(&dt->mutex);
+}
+
+int ff_h264_deblock_thread_init(H264Context *h)
+{
+    H264DeblockThread *dt;
+    int ret;
+
+    dt = h->deblock = av_mallocz(sizeof(*h->deblock));
+    if (!dt)
+        return AVERROR(ENOMEM);
+
+    if ((ret = pthread_mutex_init(&dt->mutex, NULL))) {
+        av_freep(&h->deblock);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&dt->cond, NULL))) {
+        pthread_mutex_destroy(&dt->mutex);
+        av_freep(&h->deblock);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&dt->thread, NULL, deblock_thread_worker, dt))) {
+        pthread_cond_destroy(&dt->cond);
+        pthread_mutex_destroy(&dt->mutex);
+        av_freep(&h->deblock);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+
+void ff_h264_deblock_thread_uninit(H264Context *h)
+{
+    H264DeblockThread *dt = h->deblock;
+
+    if (!dt)
+        return;
+
+    pthread_mutex_lock(&dt->mutex);
+    dt->exit = 1;
+    pthread_cond_broadcast(&dt->cond);
+    pthread_mutex_unlock(&dt->mutex);
+    pthread_join(dt->thread, NULL);
+
+    pthread_cond_destroy(&dt->cond);
+    pthread_mutex_destroy(&dt->mutex);
+    av_freep(&h->deblock);
+}
+#else
+static H264DeblockThread *deblock_thread_start(const H264Context *h,
+                                               H264SliceContext *sl)
+{
+    return NULL;
+}
+
+static void deblock_thread_queue_row(H264DeblockThread *dt, const H264Context *h,
+                                     H264SliceContext *sl)
+{
+}
+
+static void deblock_thread_flush(H264DeblockThread *dt)
+{
+}
+
+int ff_h264_deblock_thread_init(H264Context *h)
+{
+    return 0;
+}
+
+void ff_h264_deblock_thread_uninit(H264Context *h)
+{
+}
+#endif
+
+static int decode_slice_mbs(H264SliceContext *sl)
 {
-    H264SliceContext *sl = arg;
     const H264Context *h = sl->h264;
+    H264DeblockThread *dt;
     int lf_x_start = sl->mb_x;
     int orig_deblock = sl->deblocking_filter;
     int ret;
@@ -2602,6 +2803,8 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
     sl->is_complex = FRAME_MBAFF(h) || h->picture_structure != PICT_FRAME ||
                      (CONFIG_GRAY && (h->flags & AV_CODEC_FLAG_GRAY));
 
+    dt = deblock_thread_start(h, sl);
+
     if (!(h->avctx->active_thread_type & FF_THREAD_SLICE) && h->picture_structure == PICT_FRAME && h->slice_ctx[0].er.error_status_table) {
         const int start_i  = av_clip(sl->resync_mb_x + sl->resync_mb_y * h->mb_width, 0, h->mb_num - 1);
         if (start_i) {
@@ -2656,8 +2859,9 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                 sl->cabac.bytestream > sl->cabac.bytestream_end + 2) {
                 er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y, sl->mb_x - 1,
                              sl->mb_y, ER_MB_END);
+                deblock_thread_flush(dt);
                 if (sl->mb_x >= lf_x_start)
-                    loop_filter(h, sl, lf_x_start, sl->mb_x + 1);
+                    loop_filter(h, sl, lf_x_start, sl->mb_x + 1, 1);
                 goto finish;
             }
             if (sl->cabac.bytestream > sl->cabac.bytestream_end + 2 )
@@ -2673,9 +2877,13 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
             }
 
             if (++sl->mb_x >= h->mb_width) {
-                loop_filter(h, sl, lf_x_start, sl->mb_x);
+                if (dt && !lf_x_start) {
+                    deblock_thread_queue_row(dt, h, sl);
+                } else {
+                    loop_filter(h, sl, lf_x_start, sl->mb_x, 1);
+                    decode_finish_row(h, sl);
+                }
                 sl->mb_x = lf_x_start = 0;
-                decode_finish_row(h, sl);
                 ++sl->mb_y;
                 if (FIELD_OR_MBAFF_PICTURE(h)) {
                     ++sl->mb_y;
@@ -2689,8 +2897,9 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                         get_bits_count(&sl->gb), sl->gb.size_in_bits);
                 er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y, sl->mb_x - 1,
                              sl->mb_y, ER_MB_END);
+                deblock_thread_flush(dt);
                 if (sl->mb_x > lf_x_start)
-                    loop_filter(h, sl, lf_x_start, sl->mb_x);
+                    loop_filter(h, sl, lf_x_start, sl->mb_x, 1);
                 goto finish;
             }
         }
@@ -2730,9 +2939,13 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
             }
 
             if (++sl->mb_x >= h->mb_width) {
-                loop_filter(h, sl, lf_x_start, sl->mb_x);
+                if (dt && !lf_x_start) {
+                    deblock_thread_queue_row(dt, h, sl);
+                } else {
+                    loop_filter(h, sl, lf_x_start, sl->mb_x, 1);
+                    decode_finish_row(h, sl);
+                }
                 sl->mb_x = lf_x_start = 0;
-                decode_finish_row(h, sl);
                 ++sl->mb_y;
                 if (FIELD_OR_MBAFF_PICTURE(h)) {
                     ++sl->mb_y;
@@ -2765,8 +2978,9 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
                 if (get_bits_left(&sl->gb) == 0) {
                     er_add_slice(sl, sl->resync_mb_x, sl->resync_mb_y,
                                  sl->mb_x - 1, sl->mb_y, ER_MB_END);
+                    deblock_thread_flush(dt);
                     if (sl->mb_x > lf_x_start)
-                        loop_filter(h, sl, lf_x_start, sl->mb_x);
+                        loop_filter(h, sl, lf_x_start, sl->mb_x, 1);
 
                     goto finish;
                 } else {
@@ -2784,6 +2998,15 @@ finish:
     return 0;
 }
 
+static int decode_slice(struct AVCodecContext *avctx, void *arg)
+{
+    H264SliceContext *sl = arg;
+    int ret = decode_slice_mbs(sl);
+
+    deblock_thread_flush(sl->h264->deblock);
+    return ret;
+}
+
 /**
  * Call decode_slice() for each context.
  *
@@ -2861,7 +3084,7 @@ int ff_h264_execute_decode_slices(H264Context *h)
                 for (j = sl->resync_mb_y; j < y_end; j += 1 + FIELD_OR_MBAFF_PICTURE(h)) {
                     sl->mb_y = j;
                     loop_filter(h, sl, j > sl->resync_mb_y ? 0 : sl->resync_mb_x,
-                                j == y_end - 1 ? x_end : h->mb_width);
+                                j == y_end - 1 ? x_end : h->mb_width, 1);
                 }
             }
         }
@@ -332,6 +332,7 @@ static av_cold int h264_decode_end(AVCodecContext *avctx)
     H264Context *h = avctx->priv_data;
     int i;
 
+    ff_h264_deblock_thread_uninit(h);
     ff_h264_remove_all_refs(h);
     ff_h264_free_tables(h);
 
@@ -417,6 +418,12 @@ static av_cold int h264_decode_init(AVCodecContext *avctx)
                "Use it at your own risk\n");
     }
 
+    if (h->deblock_thread && !avctx->active_thread_type) {
+        ret = ff_h264_deblock_thread_init(h);
+        if (ret < 0)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -1032,6 +1039,7 @@ static const AVOption h264_options[] = {
     { "nal_length_size", "nal_length_size", OFFSET(nal_length_size), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 4, 0 },
     { "enable_er", "Enable error resilience on damaged frames (unsafe)", OFFSET(enable_er), AV_OPT_TYPE_BOOL, { .i64 = -1 }, -1, 1, VD },
     { "x264_build", "Assume this x264 version if no x264 version found in any SEI", OFFSET(x264_build), AV_OPT_TYPE_INT, {.i64 = -1}, -1, INT_MAX, VD },
+    { "deblock_thread", "Run the loop filter in a separate thread when not using frame or slice threads", OFFSET(deblock_thread), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, VD },
     { NULL },
 };
 
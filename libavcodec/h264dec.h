@@ -550,6 +550,13 @@ typedef struct H264Context {
 
     int enable_er;
 
+    /**
+     * Run the loop filter of single-threaded decoding in a separate thread,
+     * one macroblock row behind the reconstruction (deblock_thread option).
+     */
+    int deblock_thread;
+    struct H264DeblockThread *deblock;
+
     H264SEIContext sei;
 
     AVBufferPool *qscale_table_pool;
@@ -846,6 +853,12 @@ void ff_h264_draw_horiz_band(const H264Context *h, H264SliceContext *sl, int y,
  */
 int ff_h264_queue_decode_slice(H264Context *h, const H2645NAL *nal);
 int ff_h264_execute_decode_slices(H264Context *h);
+
+/**
+ * Start the thread running the loop filter, see H264Context.deblock_thread.
+ */
+int ff_h264_deblock_thread_init(H264Context *h);
+void ff_h264_deblock_thread_uninit(H264Context *h);
 int ff_h264_update_thread_context(AVCodecContext *dst,
                                   const AVCodecContext *src);
 
@@ -909,13 +909,12 @@ static int hls_slice_header(HEVCContext *s)
                 unsigned val = get_bits_long(gb, offset_len);
                 sh->entry_point_offset[i] = val + 1; // +1; // +1 to get the size
             }
-            if (s->threads_number > 1 && (s->ps.pps->num_tile_rows > 1 || s->ps.pps->num_tile_columns > 1)) {
-                s->enable_parallel_tiles = 0; // TODO: you can enable tiles in parallel here
+            // tiles are decoded in parallel, but not together with WPP
+            if (s->threads_number > 1 && s->ps.pps->entropy_coding_sync_enabled_flag &&
+                (s->ps.pps->num_tile_rows > 1 || s->ps.pps->num_tile_columns > 1))
                 s->threads_number = 1;
-            } else
-                s->enable_parallel_tiles = 0;
-        } else
-            s->enable_parallel_tiles = 0;
+        }
+        s->enable_parallel_tiles = 0;
     }
 
     if (s->ps.pps->slice_header_extension_present_flag) {
@@ -2555,6 +2554,11 @@ static int hls_decode_entry_wpp(AVCodecContext *avctxt, void *input_ctb_row, int
         if (ret < 0)
             goto error;
         hls_sao_param(s, x_ctb >> s->ps.sps->log2_ctb_size, y_ctb >> s->ps.sps->log2_ctb_size);
+
+        s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
+        s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+        s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
+
         more_data = hls_coding_quadtree(s, x_ctb, y_ctb, s->ps.sps->log2_ctb_size, 0);
 
         if (more_data < 0) {
@@ -2596,6 +2600,112 @@ error:
     return ret;
 }
 
+static int hls_decode_entry_tile(AVCodecContext *avctxt, void *input_ctb_addr_ts, int job, int self_id)
+{
+    HEVCContext *s1  = avctxt->priv_data, *s;
+    HEVCLocalContext *lc;
+    int *ctb_addr_ts_p = input_ctb_addr_ts;
+    int ctb_addr_ts  = ctb_addr_ts_p[job];
+    int ctb_addr_rs  = s1->ps.pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+    int tile_id      = s1->ps.pps->tile_id[ctb_addr_ts];
+    int more_data    = 1;
+    int idxX, ret;
+
+    s = s1->sList[self_id];
+    lc = s->HEVClc;
+
+    if (job) {
+        ret = init_get_bits8(&lc->gb, s->data + s->sh.offset[job - 1], s->sh.size[job - 1]);
+        if (ret < 0)
+            goto error;
+        lc->first_qp_group = 1;
+    } else {
+        lc->gb             = s1->HEVClc->gb;
+        lc->first_qp_group = s1->HEVClc->first_qp_group;
+    }
+    lc->qp_y = s1->HEVClc->qp_y;
+
+    idxX = s->ps.pps->col_idxX[ctb_addr_rs % s->ps.sps->ctb_width];
+    lc->end_of_tiles_x = ((ctb_addr_rs % s->ps.sps->ctb_width) + s->ps.pps->column_width[idxX]) <<
+                         s->ps.sps->log2_ctb_size;
+
+    while (more_data && ctb_addr_ts < s->ps.sps->ctb_size &&
+           s->ps.pps->tile_id[ctb_addr_ts] == tile_id) {
+        int x_ctb, y_ctb;
+
+        ctb_addr_rs = s->ps.pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+        x_ctb = (ctb_addr_rs % s->ps.sps->ctb_width) << s->ps.sps->log2_ctb_size;
+        y_ctb = (ctb_addr_rs / s->ps.sps->ctb_width) << s->ps.sps->log2_ctb_size;
+
+        hls_decode_neighbour(s, x_ctb, y_ctb, ctb_addr_ts);
+
+        ret = ff_hevc_cabac_init(s, ctb_addr_ts);
+        if (ret < 0)
+            goto error;
+
+        hls_sao_param(s, x_ctb >> s->ps.sps->log2_ctb_size, y_ctb >> s->ps.sps->log2_ctb_size);
+
+        s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
+        s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+        s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
+
+        more_data = hls_coding_quadtree(s, x_ctb, y_ctb, s->ps.sps->log2_ctb_size, 0);
+        if (more_data < 0) {
+            ret = more_data;
+            goto error;
+        }
+
+        ctb_addr_ts++;
+    }
+
+    if (!more_data && job != s->sh.num_entry_point_offsets) {
+        av_log(s->avctx, AV_LOG_ERROR, "Slice segment ends before its last tile\n");
+        ret = AVERROR_INVALIDDATA;
+        goto error;
+    }
+
+    return ctb_addr_ts;
+error:
+    s->tab_slice_address[ctb_addr_rs] = -1;
+    return ret;
+}
+
+/**
+ * Apply the in-loop filters to the tiles of a slice segment decoded in
+ * parallel, once all of them are available. The CTBs are filtered in the
+ * same order as with sequential decoding.
+ */
+static int hls_filter_tiles(HEVCContext *s, int ctb_addr_ts_start, int ctb_addr_ts_end)
+{
+    int ctb_size = 1 << s->ps.sps->log2_ctb_size;
+    int x_ctb    = 0;
+    int y_ctb    = 0;
+    int ctb_addr_ts;
+
+    for (ctb_addr_ts = ctb_addr_ts_start; ctb_addr_ts < ctb_addr_ts_end; ctb_addr_ts++) {
+        int ctb_addr_rs = s->ps.pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+
+        x_ctb = (ctb_addr_rs % s->ps.sps->ctb_width) << s->ps.sps->log2_ctb_size;
+        y_ctb = (ctb_addr_rs / s->ps.sps->ctb_width) << s->ps.sps->log2_ctb_size;
+        hls_decode_neighbour(s, x_ctb, y_ctb, ctb_addr_ts);
+        ff_hevc_deblocking_tile_boundary_strengths(s, x_ctb, y_ctb);
+    }
+
+    for (ctb_addr_ts = ctb_addr_ts_start; ctb_addr_ts < ctb_addr_ts_end; ctb_addr_ts++) {
+        int ctb_addr_rs = s->ps.pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+
+        x_ctb = (ctb_addr_rs % s->ps.sps->ctb_width) << s->ps.sps->log2_ctb_size;
+        y_ctb = (ctb_addr_rs / s->ps.sps->ctb_width) << s->ps.sps->log2_ctb_size;
+        ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
+    }
+
+    if (x_ctb + ctb_size >= s->ps.sps->width &&
+        y_ctb + ctb_size >= s->ps.sps->height)
+        ff_hevc_hls_filter(s, x_ctb, y_ctb, ctb_size);
+
+    return ctb_addr_ts_end;
+}
+
 static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
 {
     const uint8_t *data = nal->data;
@@ -2613,24 +2723,72 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
         return AVERROR(ENOMEM);
     }
 
-    if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * s->ps.sps->ctb_width >= s->ps.sps->ctb_width * s->ps.sps->ctb_height) {
-        av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
-            s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
-            s->ps.sps->ctb_width, s->ps.sps->ctb_height
-        );
-        res = AVERROR_INVALIDDATA;
-        goto error;
+    if (s->ps.pps->entropy_coding_sync_enabled_flag) {
+        if (s->sh.slice_ctb_addr_rs + s->sh.num_entry_point_offsets * s->ps.sps->ctb_width >= s->ps.sps->ctb_width * s->ps.sps->ctb_height) {
+            av_log(s->avctx, AV_LOG_ERROR, "WPP ctb addresses are wrong (%d %d %d %d)\n",
+                s->sh.slice_ctb_addr_rs, s->sh.num_entry_point_offsets,
+                s->ps.sps->ctb_width, s->ps.sps->ctb_height
+            );
+            res = AVERROR_INVALIDDATA;
+            goto error;
+        }
+    } else {
+        // one entry point per tile, the jobs get the first CTB of their tile
+        int ctb_addr_ts = s->ps.pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+        int nb_tiles    = 0;
+
+        if (ctb_addr_ts && s->ps.pps->tile_id[ctb_addr_ts] == s->ps.pps->tile_id[ctb_addr_ts - 1]) {
+            av_log(s->avctx, AV_LOG_ERROR, "Slice segment with several tiles starting within a tile\n");
+            res = AVERROR_INVALIDDATA;
+            goto error;
+        }
+        if (s->sh.dependent_slice_segment_flag) {
+            int prev_rs;
+            if (!ctb_addr_ts) {
+                av_log(s->avctx, AV_LOG_ERROR, "Impossible initial tile.\n");
+                res = AVERROR_INVALIDDATA;
+                goto error;
+            }
+            prev_rs = s->ps.pps->ctb_addr_ts_to_rs[ctb_addr_ts - 1];
+            if (s->tab_slice_address[prev_rs] != s->sh.slice_addr) {
+                av_log(s->avctx, AV_LOG_ERROR, "Previous slice segment missing\n");
+                res = AVERROR_INVALIDDATA;
+                goto error;
+            }
+        }
+
+        for (; ctb_addr_ts < s->ps.sps->ctb_size; ctb_addr_ts++) {
+            if (!nb_tiles || s->ps.pps->tile_id[ctb_addr_ts] != s->ps.pps->tile_id[ctb_addr_ts - 1]) {
+                if (nb_tiles > s->sh.num_entry_point_offsets)
+                    break;
+                arg[nb_tiles++] = ctb_addr_ts;
+            }
+            // the tiles read the slice address of their neighbours
+            s->tab_slice_address[s->ps.pps->ctb_addr_ts_to_rs[ctb_addr_ts]] = s->sh.slice_addr;
+        }
+        if (nb_tiles <= s->sh.num_entry_point_offsets) {
+            av_log(s->avctx, AV_LOG_ERROR, "More entry points than tiles (%d %d)\n",
+                   s->sh.num_entry_point_offsets, nb_tiles);
+            res = AVERROR_INVALIDDATA;
+            goto error;
+        }
     }
 
     ff_alloc_entries(s->avctx, s->sh.num_entry_point_offsets + 1);
 
-    if (!s->sList[1]) {
-        for (i = 1; i < s->threads_number; i++) {
-            s->sList[i] = av_malloc(sizeof(HEVCContext));
-            memcpy(s->sList[i], s, sizeof(HEVCContext));
-            s->HEVClcList[i] = av_mallocz(sizeof(HEVCLocalContext));
-            s->sList[i]->HEVClc = s->HEVClcList[i];
+    // threads_number can change between slices, only add the missing contexts
+    for (i = FFMAX(s->nb_local_ctx, 1); i < s->threads_number; i++) {
+        s->sList[i] = av_malloc(sizeof(HEVCContext));
+        s->HEVClcList[i] = av_mallocz(sizeof(HEVCLocalContext));
+        if (!s->sList[i] || !s->HEVClcList[i]) {
+            av_freep(&s->sList[i]);
+            av_freep(&s->HEVClcList[i]);
+            res = AVERROR(ENOMEM);
+            goto error;
         }
+        memcpy(s->sList[i], s, sizeof(HEVCContext));
+        s->sList[i]->HEVClc = s->HEVClcList[i];
+        s->nb_local_ctx = i + 1;
     }
 
     offset = (lc->gb.index >> 3);
@@ -2667,6 +2825,7 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
 
     }
     s->data = data;
+    s->enable_parallel_tiles = !s->ps.pps->entropy_coding_sync_enabled_flag;
 
     for (i = 1; i < s->threads_number; i++) {
         s->sList[i]->HEVClc->first_qp_group = 1;
@@ -2678,16 +2837,28 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
     atomic_store(&s->wpp_err, 0);
     ff_reset_entries(s->avctx);
 
-    for (i = 0; i <= s->sh.num_entry_point_offsets; i++) {
-        arg[i] = i;
-        ret[i] = 0;
-    }
+    if (s->ps.pps->entropy_coding_sync_enabled_flag) {
+        for (i = 0; i <= s->sh.num_entry_point_offsets; i++) {
+            arg[i] = i;
+            ret[i] = 0;
+        }
 
-    if (s->ps.pps->entropy_coding_sync_enabled_flag)
         s->avctx->execute2(s->avctx, hls_decode_entry_wpp, arg, ret, s->sh.num_entry_point_offsets + 1);
 
-    for (i = 0; i <= s->sh.num_entry_point_offsets; i++)
-        res += ret[i];
+        for (i = 0; i <= s->sh.num_entry_point_offsets; i++)
+            res += ret[i];
+    } else {
+        s->avctx->execute2(s->avctx, hls_decode_entry_tile, arg, ret, s->sh.num_entry_point_offsets + 1);
+        s->enable_parallel_tiles = 0;
+
+        for (i = 0; i <= s->sh.num_entry_point_offsets; i++) {
+            if (ret[i] < 0) {
+                res = ret[i];
+                goto error;
+            }
+        }
+        res = hls_filter_tiles(s, arg[0], ret[s->sh.num_entry_point_offsets]);
+    }
 error:
     av_free(ret);
     av_free(arg);
@@ -3406,12 +3577,9 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
     av_freep(&s->sh.offset);
     av_freep(&s->sh.size);
 
-    for (i = 1; i < s->threads_number; i++) {
-        HEVCLocalContext *lc = s->HEVClcList[i];
-        if (lc) {
-            av_freep(&s->HEVClcList[i]);
-            av_freep(&s->sList[i]);
-        }
+    for (i = 1; i < s->nb_local_ctx; i++) {
+        av_freep(&s->HEVClcList[i]);
+        av_freep(&s->sList[i]);
     }
     if (s->HEVClc == s->HEVClcList[0])
         s->HEVClc = NULL;
@@ -3421,6 +3589,8 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
 
     ff_hevc_reset_sei(&s->sei);
 
+    ff_slice_thread_free_nested(avctx);
+
     return 0;
 }
 
@@ -3594,6 +3764,15 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
     else
         s->threads_number = 1;
 
+    if ((avctx->active_thread_type & FF_THREAD_FRAME) && s->substream_threads > 1) {
+        ret = ff_slice_thread_init_nested(avctx, FFMIN(s->substream_threads, MAX_NB_THREADS));
+        if (ret < 0) {
+            hevc_decode_free(avctx);
+            return ret;
+        }
+        s->threads_number = ret;
+    }
+
     if (!avctx->internal->is_copy) {
         if (avctx->extradata_size > 0 && avctx->extradata) {
             ret = hevc_decode_extradata(s, avctx->extradata, avctx->extradata_size, 1);
@@ -3629,6 +3808,8 @@ static const AVOption options[] = {
         AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
     { "strict-displaywin", "stricly apply default display window size", OFFSET(apply_defdispwin),
         AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, PAR },
+    { "substream_threads", "Threads decoding the WPP rows or tiles of each frame with frame threading", OFFSET(substream_threads),
+        AV_OPT_TYPE_INT, {.i64 = 0}, 0, MAX_NB_THREADS, PAR },
     { NULL },
 };
 
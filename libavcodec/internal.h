@@ -137,6 +137,12 @@ typedef struct AVCodecInternal {
 
     void *thread_ctx;
 
+    /**
+     * Slice threads owned by a frame thread context, used by decoders which
+     * can additionally split each frame into independent jobs.
+     */
+    void *nested_slice_ctx;
+
     DecodeSimpleContext ds;
     AVBSFContext *bsf;
 
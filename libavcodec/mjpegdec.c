@@ -89,6 +89,38 @@ static int build_vlc(VLC *vlc, const uint8_t *bits_table,
                               huff_code, 2, 2, huff_sym, 2, 2, 0);
 }
 
+/* Build the table of the AC codes that are decoded with a single lookup,
+ * with their magnitude bits, see decode_block(). */
+static void build_ac_lookup(int16_t *ac_lookup, const uint8_t *bits_table,
+                            const uint8_t *val_table, int nb_codes)
+{
+    uint8_t huff_size[256];
+    uint16_t huff_code[256];
+
+    memset(ac_lookup, 0, sizeof(*ac_lookup) << AC_LOOKUP_BITS);
+
+    build_huffman_codes(huff_size, huff_code, bits_table);
+
+    for (int i = 0; i < nb_codes; i++) {
+        int run  = val_table[i] >> 4;
+        int size = val_table[i] & 0xf;
+        int len  = huff_size[i] + size;
+
+        /* the level must fit in 8 bits */
+        if (!size || size > 7 || len > AC_LOOKUP_BITS ||
+            huff_code[i] >> huff_size[i])
+            continue;
+
+        for (int m = 0; m < 1 << size; m++) {
+            int level = m >> (size - 1) ? m : m - (1 << size) + 1;
+            int index = (huff_code[i] << size | m) << (AC_LOOKUP_BITS - len);
+
+            for (int k = 0; k < 1 << (AC_LOOKUP_BITS - len); k++)
+                ac_lookup[index + k] = level * 256 + run * 16 + len;
+        }
+    }
+}
+
 static int init_default_huffman_tables(MJpegDecodeContext *s)
 {
     static const struct {
@@ -120,6 +152,10 @@ static int init_default_huffman_tables(MJpegDecodeContext *s)
         if (ret < 0)
             return ret;
 
+        if (ht[i].class == 1)
+            build_ac_lookup(s->ac_lookup[ht[i].index], ht[i].bits,
+                            ht[i].values, ht[i].length);
+
         if (ht[i].class < 2) {
             memcpy(s->raw_huffman_lengths[ht[i].class][ht[i].index],
                    ht[i].bits + 1, 16);
@@ -304,6 +340,7 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
             if ((ret = build_vlc(&s->vlcs[2][index], bits_table, val_table,
                                  n, 0)) < 0)
                 return ret;
+            build_ac_lookup(s->ac_lookup[index], bits_table, val_table, n);
         }
 
         for (i = 0; i < 16; i++)
@@ -787,10 +824,11 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
     return 0;
 }
 
-static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
+static inline int mjpeg_decode_dc(MJpegDecodeContext *s, GetBitContext *gb,
+                                  int dc_index)
 {
     int code;
-    code = get_vlc2(&s->gb, s->vlcs[0][dc_index].table, 9, 2);
+    code = get_vlc2(gb, s->vlcs[0][dc_index].table, 9, 2);
     if (code < 0 || code > 16) {
         av_log(s->avctx, AV_LOG_WARNING,
                "mjpeg_decode_dc: bad vlc: %d:%d (%p)\n",
@@ -799,57 +837,69 @@ static inline int mjpeg_decode_dc(MJpegDecodeContext *s, int dc_index)
     }
 
     if (code)
-        return get_xbits(&s->gb, code);
+        return get_xbits(gb, code);
     else
         return 0;
 }
 
 /* decode block and dequantize */
-static int decode_block(MJpegDecodeContext *s, int16_t *block, int component,
+static int decode_block(MJpegDecodeContext *s, GetBitContext *gb,
+                        int *last_dc, int16_t *block, int component,
                         int dc_index, int ac_index, uint16_t *quant_matrix)
 {
+    const int16_t *ac_lookup = s->ac_lookup[ac_index];
     int code, i, j, level, val;
 
     /* DC coef */
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
     }
-    val = val * (unsigned)quant_matrix[0] + s->last_dc[component];
+    val = val * (unsigned)quant_matrix[0] + last_dc[component];
     val = av_clip_int16(val);
-    s->last_dc[component] = val;
+    last_dc[component] = val;
     block[0] = val;
     /* AC coefs */
     i = 0;
-    {OPEN_READER(re, &s->gb);
+    {OPEN_READER(re, gb);
     do {
-        UPDATE_CACHE(re, &s->gb);
-        GET_VLC(code, re, &s->gb, s->vlcs[1][ac_index].table, 9, 2);
+        UPDATE_CACHE(re, gb);
+        code = ac_lookup[SHOW_UBITS(re, gb, AC_LOOKUP_BITS)];
 
-        i += ((unsigned)code) >> 4;
-            code &= 0xf;
         if (code) {
+            /* short code and magnitude, in a single lookup */
+            i    += ((code >> 4) & 0xf) + 1;
+            level = code >> 8;
+            LAST_SKIP_BITS(re, gb, code & 0xf);
+        } else {
+            GET_VLC(code, re, gb, s->vlcs[1][ac_index].table, 9, 2);
+
+            i   += ((unsigned)code) >> 4;
+            code &= 0xf;
+            if (!code)
+                continue;
+
             if (code > MIN_CACHE_BITS - 16)
-                UPDATE_CACHE(re, &s->gb);
+                UPDATE_CACHE(re, gb);
 
             {
-                int cache = GET_CACHE(re, &s->gb);
+                int cache = GET_CACHE(re, gb);
                 int sign  = (~cache) >> 31;
                 level     = (NEG_USR32(sign ^ cache,code) ^ sign) - sign;
             }
 
-            LAST_SKIP_BITS(re, &s->gb, code);
+            LAST_SKIP_BITS(re, gb, code);
+        }
 
-            if (i > 63) {
-                av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
-                return AVERROR_INVALIDDATA;
-            }
-            j        = s->scantable.permutated[i];
-            block[j] = level * quant_matrix[i];
+        if (i > 63) {
+            av_log(s->avctx, AV_LOG_ERROR, "error count: %d\n", i);
+            return AVERROR_INVALIDDATA;
         }
+        j        = s->scantable.permutated[i];
+        block[j] = level * quant_matrix[i];
     } while (i < 63);
-    CLOSE_READER(re, &s->gb);}
+    CLOSE_READER(re, gb);}
 
     return 0;
 }
@@ -860,7 +910,7 @@ static int decode_dc_progressive(MJpegDecodeContext *s, int16_t *block,
 {
     unsigned val;
     s->bdsp.clear_block(block);
-    val = mjpeg_decode_dc(s, dc_index);
+    val = mjpeg_decode_dc(s, &s->gb, dc_index);
     if (val == 0xfffff) {
         av_log(s->avctx, AV_LOG_ERROR, "error dc\n");
         return AVERROR_INVALIDDATA;
@@ -1150,7 +1200,7 @@ static int ljpeg_decode_rgb_scan(MJpegDecodeContext *s, int nb_components, int p
                 topleft[i] = top[i];
                 top[i]     = buffer[mb_x][i];
 
-                dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                 if(dc == 0xFFFFF)
                     return -1;
 
@@ -1282,7 +1332,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for(j=0; j<n; j++) {
                         int pred, dc;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1353,7 +1403,7 @@ static int ljpeg_decode_yuv_scan(MJpegDecodeContext *s, int predictor,
                     for (j = 0; j < n; j++) {
                         int pred;
 
-                        dc = mjpeg_decode_dc(s, s->dc_index[i]);
+                        dc = mjpeg_decode_dc(s, &s->gb, s->dc_index[i]);
                         if(dc == 0xFFFFF)
                             return -1;
                         if (   h * mb_x + x >= s->width
@@ -1422,17 +1472,196 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
+typedef struct MJpegScan {
+    int nb_components;
+    int Ah, Al;
+    int chroma_width, chroma_height;
+    int bytes_per_pixel;
+    uint8_t *data[MAX_COMPONENTS];
+    const uint8_t *reference_data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+
+    /* restart intervals decoded in parallel */
+    const uint8_t *buf;
+    int buf_size;
+    int first_offset;   ///< offset in buf of the first restart interval
+    const int *offsets; ///< offsets in buf of the next ones
+    int nb_intervals;
+    int nb_jobs;
+    int end_bits;       ///< position in buf at the end of the scan
+} MJpegScan;
+
+#define MAX_SCAN_JOBS 64
+
+static av_always_inline int decode_mcu(MJpegDecodeContext *s,
+                                       const MJpegScan *sc,
+                                       GetBitContext *gb, int *last_dc,
+                                       int16_t *mb_block, int mb_x, int mb_y,
+                                       int copy_mb)
+{
+    int i;
+
+    for (i = 0; i < sc->nb_components; i++) {
+        uint8_t *ptr;
+        int n, h, v, x, y, c, j;
+        int block_offset;
+        n = s->nb_blocks[i];
+        c = s->comp_index[i];
+        h = s->h_scount[i];
+        v = s->v_scount[i];
+        x = 0;
+        y = 0;
+        for (j = 0; j < n; j++) {
+            block_offset = (((sc->linesize[c] * (v * mb_y + y) * 8) +
+                             (h * mb_x + x) * 8 * sc->bytes_per_pixel) >> s->avctx->lowres);
+
+            if (s->interlaced && s->bottom_field)
+                block_offset += sc->linesize[c] >> 1;
+            if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? sc->chroma_width  : s->width)
+                && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? sc->chroma_height : s->height)) {
+                ptr = sc->data[c] + block_offset;
+            } else
+                ptr = NULL;
+            if (!s->progressive) {
+                if (copy_mb) {
+                    if (ptr)
+                        mjpeg_copy_block(s, ptr, sc->reference_data[c] + block_offset,
+                                        sc->linesize[c], s->avctx->lowres);
+
+                } else {
+                    s->bdsp.clear_block(mb_block);
+                    if (decode_block(s, gb, last_dc, mb_block, i,
+                                     s->dc_index[i], s->ac_index[i],
+                                     s->quant_matrixes[s->quant_sindex[i]]) < 0) {
+                        av_log(s->avctx, AV_LOG_ERROR,
+                               "error y=%d x=%d\n", mb_y, mb_x);
+                        return AVERROR_INVALIDDATA;
+                    }
+                    if (ptr) {
+                        s->idsp.idct_put(ptr, sc->linesize[c], mb_block);
+                        if (s->bits & 7)
+                            shift_output(s, ptr, sc->linesize[c]);
+                    }
+                }
+            } else {
+                int block_idx  = s->block_stride[c] * (v * mb_y + y) +
+                                 (h * mb_x + x);
+                int16_t *block = s->blocks[c][block_idx];
+                if (sc->Ah)
+                    block[0] += get_bits1(gb) *
+                                s->quant_matrixes[s->quant_sindex[i]][0] << sc->Al;
+                else if (decode_dc_progressive(s, block, i, s->dc_index[i],
+                                               s->quant_matrixes[s->quant_sindex[i]],
+                                               sc->Al) < 0) {
+                    av_log(s->avctx, AV_LOG_ERROR,
+                           "error y=%d x=%d\n", mb_y, mb_x);
+                    return AVERROR_INVALIDDATA;
+                }
+            }
+            ff_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
+            ff_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
+                    mb_x, mb_y, x, y, c, s->bottom_field,
+                    (v * mb_y + y) * 8, (h * mb_x + x) * 8);
+            if (++x == h) {
+                x = 0;
+                y++;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Check whether the restart intervals of a sequential scan can be decoded
+ * in parallel, which needs the positions of all of its RSTn markers.
+ */
+static int init_scan_intervals(MJpegDecodeContext *s, MJpegScan *sc)
+{
+    int nb_mbs = s->mb_width * s->mb_height;
+    int first, i;
+
+    if (!(s->avctx->active_thread_type & FF_THREAD_SLICE) ||
+        s->progressive || !s->restart_interval ||
+        s->gb.buffer != s->buffer || s->nb_restart_offsets <= 0 ||
+        get_bits_count(&s->gb) & 7)
+        return 0;
+
+    sc->buf          = s->gb.buffer;
+    sc->buf_size     = s->gb.buffer_end - s->gb.buffer;
+    sc->first_offset = get_bits_count(&s->gb) >> 3;
+    sc->nb_intervals = (nb_mbs + s->restart_interval - 1) / s->restart_interval;
+
+    /* skip the markers of a previous field */
+    for (first = 0; first < s->nb_restart_offsets; first++)
+        if (s->restart_offsets[first] > sc->first_offset)
+            break;
+    if (sc->nb_intervals < 2 ||
+        s->nb_restart_offsets - first < sc->nb_intervals - 1)
+        return 0;
+
+    sc->offsets = s->restart_offsets + first;
+    for (i = 0; i < sc->nb_intervals - 1; i++)
+        if ((sc->buf[sc->offsets[i] - 1] & 7) != (i & 7))
+            return 0;
+
+    sc->nb_jobs = FFMIN3(s->avctx->thread_count, sc->nb_intervals, MAX_SCAN_JOBS);
+
+    return 1;
+}
+
+static int decode_scan_intervals(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    MJpegScan *sc = arg;
+    LOCAL_ALIGNED_32(int16_t, block, [64]);
+    int last_dc[MAX_COMPONENTS];
+    int nb_mbs = s->mb_width * s->mb_height;
+    int start  = (int64_t) jobnr      * sc->nb_intervals / sc->nb_jobs;
+    int end    = (int64_t)(jobnr + 1) * sc->nb_intervals / sc->nb_jobs;
+    int i, n, ret;
+
+    for (n = start; n < end; n++) {
+        int pos     = n ? sc->offsets[n - 1] : sc->first_offset;
+        int pos_end = n + 1 < sc->nb_intervals ? sc->offsets[n] : sc->buf_size;
+        int mb      = n * s->restart_interval;
+        int mb_end  = FFMIN(mb + s->restart_interval, nb_mbs);
+        GetBitContext gb;
+
+        ret = init_get_bits8(&gb, sc->buf + pos, pos_end - pos);
+        if (ret < 0)
+            return ret;
+
+        for (i = 0; i < sc->nb_components; i++)
+            last_dc[i] = 4 << s->bits;
+
+        for (; mb < mb_end; mb++) {
+            if (get_bits_left(&gb) < 0) {
+                av_log(avctx, AV_LOG_ERROR, "overread %d\n",
+                       -get_bits_left(&gb));
+                return AVERROR_INVALIDDATA;
+            }
+            ret = decode_mcu(s, sc, &gb, last_dc, block,
+                             mb % s->mb_width, mb / s->mb_width, 0);
+            if (ret < 0)
+                return ret;
+        }
+
+        if (n == sc->nb_intervals - 1)
+            sc->end_bits = pos * 8 + get_bits_count(&gb);
+    }
+
+    return 0;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              int mb_bitmask_size,
                              const AVFrame *reference)
 {
-    int i, mb_x, mb_y, chroma_h_shift, chroma_v_shift, chroma_width, chroma_height;
-    uint8_t *data[MAX_COMPONENTS];
-    const uint8_t *reference_data[MAX_COMPONENTS];
-    int linesize[MAX_COMPONENTS];
+    int i, mb_x, mb_y, chroma_h_shift, chroma_v_shift, ret;
+    MJpegScan sc = { .nb_components = nb_components, .Ah = Ah, .Al = Al };
     GetBitContext mb_bitmask_gb = {0}; // initialize to silence gcc warning
-    int bytes_per_pixel = 1 + (s->bits > 8);
 
     if (mb_bitmask) {
         if (mb_bitmask_size != (s->mb_width * s->mb_height + 7)>>3) {
@@ -1446,17 +1675,30 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
 
     av_pix_fmt_get_chroma_sub_sample(s->avctx->pix_fmt, &chroma_h_shift,
                                      &chroma_v_shift);
-    chroma_width  = AV_CEIL_RSHIFT(s->width,  chroma_h_shift);
-    chroma_height = AV_CEIL_RSHIFT(s->height, chroma_v_shift);
+    sc.chroma_width    = AV_CEIL_RSHIFT(s->width,  chroma_h_shift);
+    sc.chroma_height   = AV_CEIL_RSHIFT(s->height, chroma_v_shift);
+    sc.bytes_per_pixel = 1 + (s->bits > 8);
 
     for (i = 0; i < nb_components; i++) {
         int c   = s->comp_index[i];
-        data[c] = s->picture_ptr->data[c];
-        reference_data[c] = reference ? reference->data[c] : NULL;
-        linesize[c] = s->linesize[c];
+        sc.data[c] = s->picture_ptr->data[c];
+        sc.reference_data[c] = reference ? reference->data[c] : NULL;
+        sc.linesize[c] = s->linesize[c];
         s->coefs_finished[c] |= 1;
     }
 
+    if (!mb_bitmask && init_scan_intervals(s, &sc)) {
+        int rets[MAX_SCAN_JOBS];
+
+        s->avctx->execute2(s->avctx, decode_scan_intervals, &sc, rets, sc.nb_jobs);
+        for (i = 0; i < sc.nb_jobs; i++)
+            if (rets[i] < 0)
+                return rets[i];
+
+        skip_bits_long(&s->gb, sc.end_bits - get_bits_count(&s->gb));
+        return 0;
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
@@ -1469,73 +1711,11 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                        -get_bits_left(&s->gb));
                 return AVERROR_INVALIDDATA;
             }
-            for (i = 0; i < nb_components; i++) {
-                uint8_t *ptr;
-                int n, h, v, x, y, c, j;
-                int block_offset;
-                n = s->nb_blocks[i];
-                c = s->comp_index[i];
-                h = s->h_scount[i];
-                v = s->v_scount[i];
-                x = 0;
-                y = 0;
-                for (j = 0; j < n; j++) {
-                    block_offset = (((linesize[c] * (v * mb_y + y) * 8) +
-                                     (h * mb_x + x) * 8 * bytes_per_pixel) >> s->avctx->lowres);
-
-                    if (s->interlaced && s->bottom_field)
-                        block_offset += linesize[c] >> 1;
-                    if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? chroma_width  : s->width)
-                        && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? chroma_height : s->height)) {
-                        ptr = data[c] + block_offset;
-                    } else
-                        ptr = NULL;
-                    if (!s->progressive) {
-                        if (copy_mb) {
-                            if (ptr)
-                                mjpeg_copy_block(s, ptr, reference_data[c] + block_offset,
-                                                linesize[c], s->avctx->lowres);
 
-                        } else {
-                            s->bdsp.clear_block(s->block);
-                            if (decode_block(s, s->block, i,
-                                             s->dc_index[i], s->ac_index[i],
-                                             s->quant_matrixes[s->quant_sindex[i]]) < 0) {
-                                av_log(s->avctx, AV_LOG_ERROR,
-                                       "error y=%d x=%d\n", mb_y, mb_x);
-                                return AVERROR_INVALIDDATA;
-                            }
-                            if (ptr) {
-                                s->idsp.idct_put(ptr, linesize[c], s->block);
-                                if (s->bits & 7)
-                                    shift_output(s, ptr, linesize[c]);
-                            }
-                        }
-                    } else {
-                        int block_idx  = s->block_stride[c] * (v * mb_y + y) +
-                                         (h * mb_x + x);
-                        int16_t *block = s->blocks[c][block_idx];
-                        if (Ah)
-                            block[0] += get_bits1(&s->gb) *
-                                        s->quant_matrixes[s->quant_sindex[i]][0] << Al;
-                        else if (decode_dc_progressive(s, block, i, s->dc_index[i],
-                                                       s->quant_matrixes[s->quant_sindex[i]],
-                                                       Al) < 0) {
-                            av_log(s->avctx, AV_LOG_ERROR,
-                                   "error y=%d x=%d\n", mb_y, mb_x);
-                            return AVERROR_INVALIDDATA;
-                        }
-                    }
-                    ff_dlog(s->avctx, "mb: %d %d processed\n", mb_y, mb_x);
-                    ff_dlog(s->avctx, "%d %d %d %d %d %d %d %d \n",
-                            mb_x, mb_y, x, y, c, s->bottom_field,
-                            (v * mb_y + y) * 8, (h * mb_x + x) * 8);
-                    if (++x == h) {
-                        x = 0;
-                        y++;
-                    }
-                }
-            }
+            ret = decode_mcu(s, &sc, &s->gb, s->last_dc, s->block,
+                             mb_x, mb_y, copy_mb);
+            if (ret < 0)
+                return ret;
 
             handle_rstn(s, nb_components);
         }
@@ -2220,6 +2400,9 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
         const uint8_t *ptr = src;
         uint8_t *dst = s->buffer;
 
+        /* the restart intervals are only decoded in parallel with slice threads */
+        s->nb_restart_offsets = s->avctx->active_thread_type & FF_THREAD_SLICE ? 0 : -1;
+
         #define copy_data_segment(skip) do {       \
             ptrdiff_t length = (ptr - src) - (skip);  \
             if (length > 0) {                         \
@@ -2257,6 +2440,16 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                         copy_data_segment(1);
                         if (x)
                             break;
+                    } else if (s->nb_restart_offsets >= 0) {
+                        int *offsets = av_fast_realloc(s->restart_offsets,
+                                                       &s->restart_offsets_size,
+                                                       (s->nb_restart_offsets + 1) * sizeof(*offsets));
+                        if (offsets) {
+                            s->restart_offsets = offsets;
+                            offsets[s->nb_restart_offsets++] = dst - s->buffer + (ptr - src);
+                        } else {
+                            s->nb_restart_offsets = -1;
+                        }
                     }
                 }
             }
@@ -2834,6 +3027,7 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
+    av_freep(&s->restart_offsets);
 
     for (i = 0; i < 3; i++) {
         for (j = 0; j < 4; j++)
@@ -2884,7 +3078,7 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .decode         = ff_mjpeg_decode_frame,
     .flush          = decode_flush,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .priv_class     = &mjpegdec_class,
     .profiles       = NULL_IF_CONFIG_SMALL(ff_mjpeg_profiles),
@@ -43,6 +43,8 @@
 
 #define MAX_COMPONENTS 4
 
+#define AC_LOOKUP_BITS 9
+
 typedef struct MJpegDecodeContext {
     AVClass *class;
     AVCodecContext *avctx;
@@ -55,6 +57,11 @@ typedef struct MJpegDecodeContext {
 
     uint16_t quant_matrixes[4][64];
     VLC vlcs[3][4];
+    /**
+     * AC codes whose run/size symbol and magnitude bits fit in AC_LOOKUP_BITS,
+     * as level << 8 | run << 4 | length, 0 for the other codes
+     */
+    int16_t ac_lookup[4][1 << AC_LOOKUP_BITS];
     int qscale[4];      ///< quantizer scale calculated from quant_matrixes
 
     int org_height;  /* size given at codec init */
@@ -114,6 +121,9 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *restart_offsets;               ///< offsets in buffer of the data following each RSTn marker of the scan
+    unsigned int restart_offsets_size;
+    int nb_restart_offsets;             ///< number of RSTn markers in the scan, -1 if not recorded
 
     int buggy_avid;
     int cs_itu601;
@@ -32,12 +32,15 @@
 #include "bytestream.h"
 #include "internal.h"
 #include "proresdata.h"
+#include "thread.h"
 
 #define CFACTOR_Y422 2
 #define CFACTOR_Y444 3
 
 #define MAX_MBS_PER_SLICE 8
 
+#define MAX_SLICE_THREADS 32 /* as MAX_THREADS for dnxhd */
+
 #define MAX_PLANES 4
 
 enum {
@@ -267,6 +270,8 @@ typedef struct ProresContext {
     int *slice_q;
 
     ProresThreadData *tdata;
+    int nb_threads;         ///< number of entries of tdata
+    int slice_threads;
 } ProresContext;
 
 static void get_slice_data(ProresContext *ctx, const uint16_t *src,
@@ -695,9 +700,9 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
                         const uint8_t *scan, const int16_t *qmat)
 {
     int idx, i;
-    int run, level, run_cb, lev_cb;
-    int max_coeffs, abs_level;
-    int bits = 0;
+    int run, q, run_cb, lev_cb;
+    int max_coeffs, abs_coeff, abs_level;
+    int bits = 0, err = 0;
 
     max_coeffs = blocks_per_slice << 6;
     run_cb     = ff_prores_run_to_cb_index[4];
@@ -705,24 +710,29 @@ static int estimate_acs(int *error, int16_t *blocks, int blocks_per_slice,
     run        = 0;
 
     for (i = 1; i < 64; i++) {
+        q = qmat[scan[i]];
         for (idx = scan[i]; idx < max_coeffs; idx += 64) {
-            level   = blocks[idx] / qmat[scan[i]];
-            *error += FFABS(blocks[idx]) % qmat[scan[i]];
-            if (level) {
-                abs_level = FFABS(level);
-                bits += estimate_vlc(ff_prores_ac_codebook[run_cb], run);
-                bits += estimate_vlc(ff_prores_ac_codebook[lev_cb],
-                                     abs_level - 1) + 1;
-
-                run_cb = ff_prores_run_to_cb_index[FFMIN(run, 15)];
-                lev_cb = ff_prores_lev_to_cb_index[FFMIN(abs_level, 9)];
-                run    = 0;
-            } else {
+            abs_coeff = FFABS(blocks[idx]);
+            /* most coefficients quantise to zero, avoid the division */
+            if (abs_coeff < q) {
+                err += abs_coeff;
                 run++;
+                continue;
             }
+            abs_level = abs_coeff / q;
+            err      += abs_coeff - abs_level * q;
+
+            bits += estimate_vlc(ff_prores_ac_codebook[run_cb], run);
+            bits += estimate_vlc(ff_prores_ac_codebook[lev_cb],
+                                 abs_level - 1) + 1;
+
+            run_cb = ff_prores_run_to_cb_index[FFMIN(run, 15)];
+            lev_cb = ff_prores_lev_to_cb_index[FFMIN(abs_level, 9)];
+            run    = 0;
         }
     }
 
+    *error += err;
     return bits;
 }
 
@@ -1161,12 +1171,14 @@ static av_cold int encode_close(AVCodecContext *avctx)
     int i;
 
     if (ctx->tdata) {
-        for (i = 0; i < avctx->thread_count; i++)
+        for (i = 0; i < ctx->nb_threads; i++)
             av_freep(&ctx->tdata[i].nodes);
     }
     av_freep(&ctx->tdata);
     av_freep(&ctx->slice_q);
 
+    ff_slice_thread_free_nested(avctx);
+
     return 0;
 }
 
@@ -1188,7 +1200,7 @@ static av_cold int encode_init(AVCodecContext *avctx)
 {
     ProresContext *ctx = avctx->priv_data;
     int mps;
-    int i, j;
+    int i, j, ret;
     int min_quant, max_quant;
     int interlaced = !!(avctx->flags & AV_CODEC_FLAG_INTERLACED_DCT);
 
@@ -1299,13 +1311,22 @@ FF_ENABLE_DEPRECATION_WARNINGS
             return AVERROR(ENOMEM);
         }
 
-        ctx->tdata = av_mallocz(avctx->thread_count * sizeof(*ctx->tdata));
+        /* the quantiser search of the slice rows is threaded with execute2(),
+         * which also runs in parallel within each frame thread if requested */
+        ret = ff_slice_thread_init_nested(avctx, ctx->slice_threads);
+        if (ret < 0) {
+            encode_close(avctx);
+            return ret;
+        }
+        ctx->nb_threads = FFMAX(avctx->thread_count, ret);
+
+        ctx->tdata = av_mallocz(ctx->nb_threads * sizeof(*ctx->tdata));
         if (!ctx->tdata) {
             encode_close(avctx);
             return AVERROR(ENOMEM);
         }
 
-        for (j = 0; j < avctx->thread_count; j++) {
+        for (j = 0; j < ctx->nb_threads; j++) {
             ctx->tdata[j].nodes = av_malloc((ctx->slices_width + 1)
                                             * TRELLIS_WIDTH
                                             * sizeof(*ctx->tdata->nodes));
@@ -1409,6 +1430,8 @@ static const AVOption options[] = {
         0, 0, VE, "quant_mat" },
     { "alpha_bits", "bits for alpha plane", OFFSET(alpha_bits), AV_OPT_TYPE_INT,
         { .i64 = 16 }, 0, 16, VE },
+    { "slice_threads", "threads searching the slice quantisers of each frame with frame threading",
+        OFFSET(slice_threads), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, MAX_SLICE_THREADS, VE },
     { NULL }
 };
 
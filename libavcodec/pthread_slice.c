@@ -56,16 +56,27 @@ typedef struct SliceThreadContext {
     pthread_mutex_t *progress_mutex;
 } SliceThreadContext;
 
+/**
+ * The slice threads of a context using slice threading, or the nested slice
+ * threads of a frame thread context.
+ */
+static SliceThreadContext *get_slice_ctx(AVCodecContext *avctx)
+{
+    if (avctx->internal->nested_slice_ctx)
+        return avctx->internal->nested_slice_ctx;
+    return avctx->active_thread_type & FF_THREAD_SLICE ? avctx->internal->thread_ctx : NULL;
+}
+
 static void main_function(void *priv) {
     AVCodecContext *avctx = priv;
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = get_slice_ctx(avctx);
     c->mainfunc(avctx);
 }
 
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
 {
     AVCodecContext *avctx = priv;
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = get_slice_ctx(avctx);
     int ret;
 
     ret = c->func ? c->func(avctx, (char *)c->args + c->job_size * jobnr)
@@ -74,29 +85,36 @@ static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb
         c->rets[jobnr] = ret;
 }
 
-void ff_slice_thread_free(AVCodecContext *avctx)
+static void slice_thread_free(void **pc)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = *pc;
     int i;
 
     avpriv_slicethread_free(&c->thread);
 
-    for (i = 0; i < c->thread_count; i++) {
-        pthread_mutex_destroy(&c->progress_mutex[i]);
-        pthread_cond_destroy(&c->progress_cond[i]);
+    if (c->progress_mutex) {
+        for (i = 0; i < c->thread_count; i++) {
+            pthread_mutex_destroy(&c->progress_mutex[i]);
+            pthread_cond_destroy(&c->progress_cond[i]);
+        }
     }
 
     av_freep(&c->entries);
     av_freep(&c->progress_mutex);
     av_freep(&c->progress_cond);
-    av_freep(&avctx->internal->thread_ctx);
+    av_freep(pc);
+}
+
+void ff_slice_thread_free(AVCodecContext *avctx)
+{
+    slice_thread_free(&avctx->internal->thread_ctx);
 }
 
 static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, int *ret, int job_count, int job_size)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = get_slice_ctx(avctx);
 
-    if (!(avctx->active_thread_type&FF_THREAD_SLICE) || avctx->thread_count <= 1)
+    if (!c || c->thread_count <= 1)
         return avcodec_default_execute(avctx, func, arg, ret, job_count, job_size);
 
     if (job_count <= 0)
@@ -113,14 +131,17 @@ static int thread_execute(AVCodecContext *avctx, action_func* func, void *arg, i
 
 static int thread_execute2(AVCodecContext *avctx, action_func2* func2, void *arg, int *ret, int job_count)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = get_slice_ctx(avctx);
+
+    if (!c)
+        return avcodec_default_execute2(avctx, func2, arg, ret, job_count);
     c->func2 = func2;
     return thread_execute(avctx, NULL, arg, ret, job_count, 0);
 }
 
 int ff_slice_thread_execute_with_mainfunc(AVCodecContext *avctx, action_func2* func2, main_func *mainfunc, void *arg, int *ret, int job_count)
 {
-    SliceThreadContext *c = avctx->internal->thread_ctx;
+    SliceThreadContext *c = get_slice_ctx(avctx);
     c->func2 = func2;
     c->mainfunc = mainfunc;
     return thread_execute(avctx, NULL, arg, ret, job_count, 0);
@@ -164,16 +185,49 @@ int ff_slice_thread_init(AVCodecContext *avctx)
         avctx->active_thread_type = 0;
         return 0;
     }
-    avctx->thread_count = thread_count;
+    avctx->thread_count = c->thread_count = thread_count;
 
     avctx->execute = thread_execute;
     avctx->execute2 = thread_execute2;
     return 0;
 }
 
+int ff_slice_thread_init_nested(AVCodecContext *avctx, int thread_count)
+{
+    SliceThreadContext *c;
+
+    /* nothing to do if the jobs already run in parallel, or for the parent
+     * context of frame thread encoding, which does not encode itself */
+    if (thread_count <= 1 || avctx->active_thread_type & FF_THREAD_SLICE ||
+        (av_codec_is_encoder(avctx->codec) && avctx->active_thread_type & FF_THREAD_FRAME))
+        return 1;
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+    thread_count = avpriv_slicethread_create(&c->thread, avctx, worker_func, NULL, thread_count);
+    if (thread_count <= 1) {
+        avpriv_slicethread_free(&c->thread);
+        av_free(c);
+        return 1;
+    }
+    c->thread_count = thread_count;
+
+    avctx->internal->nested_slice_ctx = c;
+    avctx->execute  = thread_execute;
+    avctx->execute2 = thread_execute2;
+    return thread_count;
+}
+
+void ff_slice_thread_free_nested(AVCodecContext *avctx)
+{
+    if (avctx->internal->nested_slice_ctx)
+        slice_thread_free(&avctx->internal->nested_slice_ctx);
+}
+
 void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, int n)
 {
-    SliceThreadContext *p = avctx->internal->thread_ctx;
+    SliceThreadContext *p = get_slice_ctx(avctx);
     int *entries = p->entries;
 
     pthread_mutex_lock(&p->progress_mutex[thread]);
@@ -184,7 +238,7 @@ void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, in
 
 void ff_thread_await_progress2(AVCodecContext *avctx, int field, int thread, int shift)
 {
-    SliceThreadContext *p  = avctx->internal->thread_ctx;
+    SliceThreadContext *p  = get_slice_ctx(avctx);
     int *entries      = p->entries;
 
     if (!entries || !field) return;
@@ -200,17 +254,11 @@ void ff_thread_await_progress2(AVCodecContext *avctx, int field, int thread, int
 
 int ff_alloc_entries(AVCodecContext *avctx, int count)
 {
+    SliceThreadContext *p = get_slice_ctx(avctx);
     int i;
 
-    if (avctx->active_thread_type & FF_THREAD_SLICE)  {
-        SliceThreadContext *p = avctx->internal->thread_ctx;
-
-        if (p->entries) {
-            av_assert0(p->thread_count == avctx->thread_count);
-            av_freep(&p->entries);
-        }
-
-        p->thread_count  = avctx->thread_count;
+    if (p) {
+        av_freep(&p->entries);
         p->entries       = av_mallocz_array(count, sizeof(int));
 
         if (!p->progress_mutex) {
@@ -237,6 +285,6 @@ int ff_alloc_entries(AVCodecContext *avctx, int count)
 
 void ff_reset_entries(AVCodecContext *avctx)
 {
-    SliceThreadContext *p = avctx->internal->thread_ctx;
+    SliceThreadContext *p = get_slice_ctx(avctx);
     memset(p->entries, 0, p->entries_count * sizeof(int));
 }
@@ -0,0 +1,272 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Bitstream reader test and benchmark.
+ *
+ * The symbols are read with the access patterns of the bit reader bound
+ * decoders: fixed width fields and flags (MPEG-2, VC-1 and ProRes headers),
+ * exp-golomb codes (H.264 CAVLC), VLC tables with a second level (H.264
+ * coeff_token, MPEG-2 and VC-1 DCT coefficients) and rice codes (ProRes,
+ * lossless codecs). This file is built once for each reader, see
+ * get_bits_long.c and get_bits_cached.c.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/internal.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+
+#include "libavcodec/get_bits.h"
+#include "libavcodec/golomb.h"
+#include "libavcodec/put_bits.h"
+#include "libavcodec/unary.h"
+
+#if CACHED_BITSTREAM_READER
+#define READER_NAME "cached 64-bit"
+#elif defined(LONG_BITSTREAM_READER)
+#define READER_NAME "64-bit refill"
+#else
+#define READER_NAME "32-bit refill"
+#endif
+
+#define COUNT (1 << 16)
+#define SIZE  (COUNT * 4 + AV_INPUT_BUFFER_PADDING_SIZE)
+
+#define VLC_BITS    9
+#define VLC_CODES  62
+#define RICE_K      4
+#define RICE_LIMIT 12
+
+enum Pattern {
+    PATTERN_FIXED,
+    PATTERN_FLAGS,
+    PATTERN_GOLOMB,
+    PATTERN_VLC,
+    PATTERN_RICE,
+    NB_PATTERNS
+};
+
+static const char *const pattern_names[NB_PATTERNS] = {
+    "fixed", "flags", "exp-golomb", "vlc", "rice",
+};
+
+static uint8_t  vlc_lens[VLC_CODES];
+static uint16_t vlc_codes[VLC_CODES];
+
+/* A complete canonical code with lengths from 2 to 16 bits. */
+static void init_vlc_code(void)
+{
+    static const uint8_t lens_count[][2] = {
+        {  2, 2 }, {  3, 2 }, {  4, 2 }, {  5, 2 }, {  6, 2 }, {  7, 2 },
+        {  8, 2 }, {  9, 2 }, { 10, 2 }, { 12, 4 }, { 14, 8 }, { 16, 32 },
+    };
+    unsigned code = 0;
+    int i, j, n = 0, len = 0;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(lens_count); i++) {
+        code <<= lens_count[i][0] - len;
+        len    = lens_count[i][0];
+        for (j = 0; j < lens_count[i][1]; j++) {
+            vlc_lens[n]    = len;
+            vlc_codes[n++] = code++;
+        }
+    }
+}
+
+/* Pick a symbol with the probability implied by its code length. */
+static int random_vlc_symbol(AVLFG *lfg)
+{
+    unsigned bits = av_lfg_get(lfg) & 0xffff;
+    int i;
+
+    for (i = 0; i < VLC_CODES - 1; i++)
+        if (bits >> (16 - vlc_lens[i]) == vlc_codes[i])
+            break;
+    return i;
+}
+
+static void write_symbols(enum Pattern pattern, PutBitContext *pb, AVLFG *lfg,
+                          int *values, int *sizes)
+{
+    int i;
+
+    for (i = 0; i < COUNT; i++) {
+        unsigned r = av_lfg_get(lfg);
+
+        switch (pattern) {
+        case PATTERN_FIXED:
+            sizes[i]  = 1 + r % 25;
+            values[i] = (r >> 5) & ((1 << sizes[i]) - 1);
+            put_bits(pb, sizes[i], values[i]);
+            break;
+        case PATTERN_FLAGS:
+            values[i] = (r >> 7) & 1;
+            put_bits(pb, 1, values[i]);
+            break;
+        case PATTERN_GOLOMB:
+            /* mostly small values, as in the macroblock layer */
+            values[i] = ((r >> 8) & 0x3ff) >> (r & 7);
+            sizes[i]  = (r >> 11) & 1; // signed
+            if (sizes[i]) {
+                if (r & 0x1000)
+                    values[i] = -values[i];
+                set_se_golomb(pb, values[i]);
+            } else {
+                set_ue_golomb(pb, values[i]);
+            }
+            break;
+        case PATTERN_VLC:
+            values[i] = random_vlc_symbol(lfg);
+            put_bits(pb, vlc_lens[values[i]], vlc_codes[values[i]]);
+            break;
+        case PATTERN_RICE: {
+            int q = FFMIN(ff_ctz(r | 1U << RICE_LIMIT), RICE_LIMIT);
+
+            values[i] = q << RICE_K | (r >> 24 & ((1 << RICE_K) - 1));
+            /* the escape at the limit has no terminating zero */
+            if (q < RICE_LIMIT)
+                put_bits(pb, q + 1, ((1 << q) - 1) << 1);
+            else
+                put_bits(pb, q, (1 << q) - 1);
+            put_bits(pb, RICE_K, values[i] & ((1 << RICE_K) - 1));
+            break;
+        }
+        default:
+            av_assert0(0);
+        }
+    }
+}
+
+static void read_symbols(enum Pattern pattern, const uint8_t *buf, int size,
+                         const int *sizes, int *out, const VLC *vlc)
+{
+    GetBitContext gb;
+    int i;
+
+    init_get_bits8(&gb, buf, size);
+
+    switch (pattern) {
+    case PATTERN_FIXED:
+        for (i = 0; i < COUNT; i++)
+            out[i] = get_bits(&gb, sizes[i]);
+        break;
+    case PATTERN_FLAGS:
+        for (i = 0; i < COUNT; i++)
+            out[i] = get_bits1(&gb);
+        break;
+    case PATTERN_GOLOMB:
+        for (i = 0; i < COUNT; i++)
+            out[i] = sizes[i] ? get_se_golomb(&gb) : get_ue_golomb(&gb);
+        break;
+    case PATTERN_VLC:
+        for (i = 0; i < COUNT; i++)
+            out[i] = get_vlc2(&gb, vlc->table, VLC_BITS, 2);
+        break;
+    case PATTERN_RICE:
+        for (i = 0; i < COUNT; i++) {
+            int q  = get_unary(&gb, 0, RICE_LIMIT);
+            out[i] = q << RICE_K | get_bits(&gb, RICE_K);
+        }
+        break;
+    default:
+        av_assert0(0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int speed = argc > 1 && !strcmp(argv[1], "-t");
+    int *values, *sizes, *out;
+    uint8_t *buf;
+    AVLFG lfg;
+    VLC vlc;
+    int ret = 0, pattern;
+
+    buf    = av_mallocz(SIZE);
+    values = av_malloc_array(COUNT, sizeof(*values));
+    sizes  = av_mallocz_array(COUNT, sizeof(*sizes));
+    out    = av_malloc_array(COUNT, sizeof(*out));
+    if (!buf || !values || !sizes || !out) {
+        ret = 2;
+        goto end;
+    }
+
+    init_vlc_code();
+    if (init_vlc(&vlc, VLC_BITS, VLC_CODES, vlc_lens, 1, 1,
+                 vlc_codes, 2, 2, 0) < 0) {
+        ret = 2;
+        goto end;
+    }
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    for (pattern = 0; pattern < NB_PATTERNS; pattern++) {
+        PutBitContext pb;
+        int i, size;
+
+        init_put_bits(&pb, buf, SIZE - AV_INPUT_BUFFER_PADDING_SIZE);
+        write_symbols(pattern, &pb, &lfg, values, sizes);
+        flush_put_bits(&pb);
+        size = put_bits_count(&pb) >> 3;
+
+        read_symbols(pattern, buf, size, sizes, out, &vlc);
+        for (i = 0; i < COUNT; i++) {
+            if (out[i] != values[i]) {
+                fprintf(stderr, "%s (%s): symbol %d: expected %d, got %d\n",
+                        pattern_names[pattern], READER_NAME, i, values[i], out[i]);
+                ret = 1;
+                break;
+            }
+        }
+
+        if (speed) {
+            int64_t time_start, duration;
+            int nb_its = 1, it;
+
+            /* we measure during about 1 second */
+            for (;;) {
+                time_start = av_gettime_relative();
+                for (it = 0; it < nb_its; it++)
+                    read_symbols(pattern, buf, size, sizes, out, &vlc);
+                duration = av_gettime_relative() - time_start;
+                if (duration >= 1000000)
+                    break;
+                nb_its *= 2;
+            }
+            printf("%-10s (%s): %7.1f Msymbols/s %7.1f Mbit/s\n",
+                   pattern_names[pattern], READER_NAME,
+                   (double) COUNT * nb_its / duration,
+                   (double) size * 8 * nb_its / duration);
+        }
+    }
+
+    ff_free_vlc(&vlc);
+end:
+    av_free(buf);
+    av_free(values);
+    av_free(sizes);
+    av_free(out);
+    return ret;
+}
@@ -141,4 +141,16 @@ void ff_reset_entries(AVCodecContext *avctx);
 void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, int n);
 void ff_thread_await_progress2(AVCodecContext *avctx,  int field, int thread, int shift);
 
+/**
+ * Start a pool of slice threads for a context not using slice threading,
+ * typically a frame thread context, so that the execute() and execute2()
+ * callbacks run their jobs in parallel within each frame thread. Only to be
+ * called from the init function of a codec.
+ *
+ * @return the number of slice threads, 1 if none were started, or a
+ *         negative error code
+ */
+int ff_slice_thread_init_nested(AVCodecContext *avctx, int thread_count);
+void ff_slice_thread_free_nested(AVCodecContext *avctx);
+
 #endif /* AVCODEC_THREAD_H */
@@ -1939,6 +1939,15 @@ void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, in
 {
 }
 
+int ff_slice_thread_init_nested(AVCodecContext *avctx, int thread_count)
+{
+    return 1;
+}
+
+void ff_slice_thread_free_nested(AVCodecContext *avctx)
+{
+}
+
 #endif
 
 int avcodec_is_open(AVCodecContext *s)
@@ -76,7 +76,7 @@ static int vp9_alloc_entries(AVCodecContext *avctx, int n) {
 static void vp9_report_tile_progress(VP9Context *s, int field, int n) {
     pthread_mutex_lock(&s->progress_mutex);
     atomic_fetch_add_explicit(&s->entries[field], n, memory_order_release);
-    pthread_cond_signal(&s->progress_cond);
+    pthread_cond_broadcast(&s->progress_cond);
     pthread_mutex_unlock(&s->progress_mutex);
 }
 
@@ -311,14 +311,15 @@ static int update_block_buffers(AVCodecContext *avctx)
     VP9Context *s = avctx->priv_data;
     int chroma_blocks, chroma_eobs, bytesperpixel = s->bytesperpixel;
     VP9TileData *td = &s->td[0];
+    int whole_frame = s->s.frames[CUR_FRAME].uses_2pass || s->sb_row_pipeline;
 
-    if (td->b_base && td->block_base && s->block_alloc_using_2pass == s->s.frames[CUR_FRAME].uses_2pass)
+    if (td->b_base && td->block_base && s->block_alloc_using_2pass == whole_frame)
         return 0;
 
     vp9_tile_data_free(td);
     chroma_blocks = 64 * 64 >> (s->ss_h + s->ss_v);
     chroma_eobs   = 16 * 16 >> (s->ss_h + s->ss_v);
-    if (s->s.frames[CUR_FRAME].uses_2pass) {
+    if (whole_frame) {
         int sbs = s->sb_cols * s->sb_rows;
 
         td->b_base = av_malloc_array(s->cols * s->rows, sizeof(VP9Block));
@@ -360,7 +361,7 @@ static int update_block_buffers(AVCodecContext *avctx)
             }
         }
     }
-    s->block_alloc_using_2pass = s->s.frames[CUR_FRAME].uses_2pass;
+    s->block_alloc_using_2pass = whole_frame;
 
     return 0;
 }
@@ -786,7 +787,7 @@ static int decode_frame_header(AVCodecContext *avctx,
     s->s.h.tiling.log2_tile_rows = decode012(&s->gb);
     s->s.h.tiling.tile_rows = 1 << s->s.h.tiling.log2_tile_rows;
     if (s->s.h.tiling.tile_cols != (1 << s->s.h.tiling.log2_tile_cols)) {
-        int n_range_coders;
+        int n_range_coders, n_tds;
         VP56RangeCoder *rc;
 
         if (s->td) {
@@ -799,18 +800,23 @@ static int decode_frame_header(AVCodecContext *avctx,
         vp9_free_entries(avctx);
         s->active_tile_cols = avctx->active_thread_type == FF_THREAD_SLICE ?
                               s->s.h.tiling.tile_cols : 1;
+        s->sb_row_pipeline  = avctx->active_thread_type == FF_THREAD_SLICE &&
+                              s->s.h.tiling.tile_cols == 1;
         vp9_alloc_entries(avctx, s->sb_rows);
         if (avctx->active_thread_type == FF_THREAD_SLICE) {
             n_range_coders = 4; // max_tile_rows
         } else {
             n_range_coders = s->s.h.tiling.tile_cols;
         }
-        s->td = av_mallocz_array(s->active_tile_cols, sizeof(VP9TileData) +
+        // the reconstruction job of the pipeline gets its own tile data,
+        // which shares the block buffers of td[0]
+        n_tds = s->active_tile_cols + s->sb_row_pipeline;
+        s->td = av_mallocz_array(n_tds, sizeof(VP9TileData) +
                                  n_range_coders * sizeof(VP56RangeCoder));
         if (!s->td)
             return AVERROR(ENOMEM);
-        rc = (VP56RangeCoder *) &s->td[s->active_tile_cols];
-        for (i = 0; i < s->active_tile_cols; i++) {
+        rc = (VP56RangeCoder *) &s->td[n_tds];
+        for (i = 0; i < n_tds; i++) {
             s->td[i].s = s;
             s->td[i].c_b = rc;
             rc += n_range_coders;
@@ -1467,6 +1473,103 @@ int decode_tiles_mt(AVCodecContext *avctx, void *tdata, int jobnr,
     return 0;
 }
 
+static void decode_sb_rows(VP9Context *s)
+{
+    VP9TileData *td = &s->td[0];
+    int row, col, tile_row;
+    int tile_row_start, tile_row_end;
+
+    td->pass = 1;
+    td->tile_col_start = 0;
+
+    for (tile_row = 0; tile_row < s->s.h.tiling.tile_rows; tile_row++) {
+        set_tile_offset(&tile_row_start, &tile_row_end,
+                        tile_row, s->s.h.tiling.log2_tile_rows, s->sb_rows);
+
+        td->c = &td->c_b[tile_row];
+        for (row = tile_row_start; row < tile_row_end; row += 8) {
+            VP9Filter *lflvl_ptr = s->lflvl + s->sb_cols * (row >> 3);
+
+            memset(td->left_partition_ctx, 0, 8);
+            memset(td->left_skip_ctx, 0, 8);
+            if (s->s.h.keyframe || s->s.h.intraonly) {
+                memset(td->left_mode_ctx, DC_PRED, 16);
+            } else {
+                memset(td->left_mode_ctx, NEARESTMV, 8);
+            }
+            memset(td->left_y_nnz_ctx, 0, 16);
+            memset(td->left_uv_nnz_ctx, 0, 32);
+            memset(td->left_segpred_ctx, 0, 8);
+
+            for (col = 0; col < s->cols; col += 8, lflvl_ptr++)
+                decode_sb(td, row, col, lflvl_ptr, 0, 0, BL_64X64);
+
+            vp9_report_tile_progress(s, row >> 3, 1);
+        }
+    }
+}
+
+static void reconstruct_sb_rows(VP9Context *s)
+{
+    VP9TileData *td = &s->td[1];
+    AVFrame *f = s->s.frames[CUR_FRAME].tf.f;
+    ptrdiff_t ls_y = f->linesize[0], ls_uv = f->linesize[1];
+    ptrdiff_t yoff = 0, uvoff = 0;
+    int bytesperpixel = s->bytesperpixel, row, col;
+
+    td->pass = 2;
+    td->tile_col_start = 0;
+
+    for (row = 0; row < s->rows;
+         row += 8, yoff += ls_y * 64, uvoff += ls_uv * 64 >> s->ss_v) {
+        VP9Filter *lflvl_ptr = s->lflvl + s->sb_cols * (row >> 3);
+        ptrdiff_t yoff2 = yoff, uvoff2 = uvoff;
+
+        vp9_await_tile_progress(s, row >> 3, 1);
+
+        for (col = 0; col < s->cols;
+             col += 8, yoff2 += 64 * bytesperpixel,
+             uvoff2 += 64 * bytesperpixel >> s->ss_h, lflvl_ptr++) {
+            memset(lflvl_ptr->mask, 0, sizeof(lflvl_ptr->mask));
+            decode_sb_mem(td, row, col, lflvl_ptr, yoff2, uvoff2, BL_64X64);
+        }
+
+        // backup pre-loopfilter reconstruction data for intra
+        // prediction of next row of sb64s
+        if (row + 8 < s->rows) {
+            memcpy(s->intra_pred_data[0],
+                   f->data[0] + yoff + 63 * ls_y,
+                   8 * s->cols * bytesperpixel);
+            memcpy(s->intra_pred_data[1],
+                   f->data[1] + uvoff + ((64 >> s->ss_v) - 1) * ls_uv,
+                   8 * s->cols * bytesperpixel >> s->ss_h);
+            memcpy(s->intra_pred_data[2],
+                   f->data[2] + uvoff + ((64 >> s->ss_v) - 1) * ls_uv,
+                   8 * s->cols * bytesperpixel >> s->ss_h);
+        }
+
+        vp9_report_tile_progress(s, row >> 3, 1);
+    }
+}
+
+/**
+ * Superblock row pipeline for single tile column frames: job 0 decodes the
+ * symbols of the rows into the whole-frame block buffers, job 1 reconstructs
+ * them as soon as they are decoded, and loopfilter_proc() filters them on
+ * the main thread.
+ */
+static int decode_sb_rows_mt(AVCodecContext *avctx, void *tdata, int jobnr,
+                             int threadnr)
+{
+    VP9Context *s = avctx->priv_data;
+
+    if (jobnr)
+        reconstruct_sb_rows(s);
+    else
+        decode_sb_rows(s);
+    return 0;
+}
+
 static av_always_inline
 int loopfilter_proc(AVCodecContext *avctx)
 {
@@ -1481,7 +1584,8 @@ int loopfilter_proc(AVCodecContext *avctx)
     ls_uv =f->linesize[1];
 
     for (i = 0; i < s->sb_rows; i++) {
-        vp9_await_tile_progress(s, i, s->s.h.tiling.tile_cols);
+        // the pipeline reports each row twice, after decoding and reconstruction
+        vp9_await_tile_progress(s, i, s->sb_row_pipeline ? 2 : s->s.h.tiling.tile_cols);
 
         if (s->s.h.filter.level) {
             yoff = (ls_y * 64)*i;
@@ -1698,6 +1802,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
             s->td[i].uveob[0] = s->td[i].uveob_base[0];
             s->td[i].uveob[1] = s->td[i].uveob_base[1];
             s->td[i].error_info = 0;
+            s->td[i].pass = s->pass;
         }
 
 #if HAVE_THREADS
@@ -1730,7 +1835,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 }
             }
 
-            ff_slice_thread_execute_with_mainfunc(avctx, decode_tiles_mt, loopfilter_proc, s->td, NULL, s->s.h.tiling.tile_cols);
+            if (s->sb_row_pipeline) {
+                VP9TileData *td = &s->td[1];
+
+                td->b          = s->td[0].b_base;
+                td->block      = s->td[0].block_base;
+                td->uvblock[0] = s->td[0].uvblock_base[0];
+                td->uvblock[1] = s->td[0].uvblock_base[1];
+                td->eob        = s->td[0].eob_base;
+                td->uveob[0]   = s->td[0].uveob_base[0];
+                td->uveob[1]   = s->td[0].uveob_base[1];
+                ff_slice_thread_execute_with_mainfunc(avctx, decode_sb_rows_mt, loopfilter_proc, s->td, NULL, 2);
+            } else {
+                ff_slice_thread_execute_with_mainfunc(avctx, decode_tiles_mt, loopfilter_proc, s->td, NULL, s->s.h.tiling.tile_cols);
+            }
         } else
 #endif
         {
@@ -1282,7 +1282,7 @@ void ff_vp9_decode_block(VP9TileData *td, int row, int col,
     td->max_mv.x = 128 + (s->cols - col - w4) * 64;
     td->max_mv.y = 128 + (s->rows - row - h4) * 64;
 
-    if (s->pass < 2) {
+    if (td->pass < 2) {
         b->bs = bs;
         b->bl = bl;
         b->bp = bp;
@@ -1348,14 +1348,14 @@ void ff_vp9_decode_block(VP9TileData *td, int row, int col,
             }
         }
 
-        if (s->pass == 1) {
-            s->td[0].b++;
-            s->td[0].block += w4 * h4 * 64 * bytesperpixel;
-            s->td[0].uvblock[0] += w4 * h4 * 64 * bytesperpixel >> (s->ss_h + s->ss_v);
-            s->td[0].uvblock[1] += w4 * h4 * 64 * bytesperpixel >> (s->ss_h + s->ss_v);
-            s->td[0].eob += 4 * w4 * h4;
-            s->td[0].uveob[0] += 4 * w4 * h4 >> (s->ss_h + s->ss_v);
-            s->td[0].uveob[1] += 4 * w4 * h4 >> (s->ss_h + s->ss_v);
+        if (td->pass == 1) {
+            td->b++;
+            td->block += w4 * h4 * 64 * bytesperpixel;
+            td->uvblock[0] += w4 * h4 * 64 * bytesperpixel >> (s->ss_h + s->ss_v);
+            td->uvblock[1] += w4 * h4 * 64 * bytesperpixel >> (s->ss_h + s->ss_v);
+            td->eob += 4 * w4 * h4;
+            td->uveob[0] += 4 * w4 * h4 >> (s->ss_h + s->ss_v);
+            td->uveob[1] += 4 * w4 * h4 >> (s->ss_h + s->ss_v);
 
             return;
         }
@@ -1445,13 +1445,13 @@ void ff_vp9_decode_block(VP9TileData *td, int row, int col,
                        b->uvtx, skip_inter);
     }
 
-    if (s->pass == 2) {
-        s->td[0].b++;
-        s->td[0].block += w4 * h4 * 64 * bytesperpixel;
-        s->td[0].uvblock[0] += w4 * h4 * 64 * bytesperpixel >> (s->ss_v + s->ss_h);
-        s->td[0].uvblock[1] += w4 * h4 * 64 * bytesperpixel >> (s->ss_v + s->ss_h);
-        s->td[0].eob += 4 * w4 * h4;
-        s->td[0].uveob[0] += 4 * w4 * h4 >> (s->ss_v + s->ss_h);
-        s->td[0].uveob[1] += 4 * w4 * h4 >> (s->ss_v + s->ss_h);
+    if (td->pass == 2) {
+        td->b++;
+        td->block += w4 * h4 * 64 * bytesperpixel;
+        td->uvblock[0] += w4 * h4 * 64 * bytesperpixel >> (s->ss_v + s->ss_h);
+        td->uvblock[1] += w4 * h4 * 64 * bytesperpixel >> (s->ss_v + s->ss_h);
+        td->eob += 4 * w4 * h4;
+        td->uveob[0] += 4 * w4 * h4 >> (s->ss_v + s->ss_h);
+        td->uveob[1] += 4 * w4 * h4 >> (s->ss_v + s->ss_h);
     }
 }
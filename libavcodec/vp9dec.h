@@ -99,6 +99,9 @@ typedef struct VP9Context {
     GetBitContext gb;
     VP56RangeCoder c;
     int pass, active_tile_cols;
+    // with a single tile column, slice threads decode the symbols and
+    // reconstruct the superblock rows in separate jobs
+    int sb_row_pipeline;
 
 #if HAVE_THREADS
     pthread_mutex_t progress_mutex;
@@ -171,6 +174,7 @@ struct VP9TileData {
     ptrdiff_t y_stride, uv_stride;
     VP9Block *b_base, *b;
     unsigned tile_col_start;
+    int pass;
 
     struct {
         unsigned y_mode[4][10];
@@ -31,6 +31,7 @@
 enum SearchMethod {
     EXHAUSTIVE,        ///< Search all possible positions
     SMART_EXHAUSTIVE,  ///< Search most possible positions (faster)
+    PYRAMID,           ///< Search a half resolution image, then refine (fastest)
     SEARCH_COUNT
 };
 
@@ -65,6 +66,12 @@ typedef struct DeshakeContext {
     int contrast;              ///< Contrast threshold
     int search;                ///< Motion search method
     av_pixelutils_sad_fn sad;  ///< Sum of the absolute difference function
+    av_pixelutils_sad_fn sad_half; ///< 8x8 SAD used on the half resolution images
+    IntMotionVector *block_mv; ///< Scratch buffer for block motion vectors
+    unsigned block_mv_size;
+    uint8_t *half[2];          ///< Half resolution reference and current images
+    unsigned half_size[2];
+    int half_stride;
     Transform last;            ///< Transform from last frame
     int refcount;              ///< Number of reference frames (defines averaging window)
     FILE *fp;
@@ -577,6 +577,19 @@ static void blend_line_hv16(uint8_t *dst, int dst_delta,
 {
     int x;
 
+    if (l2depth == 3 && !hsub && !vsub) {
+        /* fast path for full resolution planes and 8-bit masks */
+        mask += xm;
+        for (x = 0; x < w; x++) {
+            if (mask[x]) {
+                unsigned a = mask[x] * alpha;
+                AV_WL16(dst, ((0x10001 - a) * AV_RL16(dst) + a * src) >> 16);
+            }
+            dst += dst_delta;
+        }
+        return;
+    }
+
     if (left) {
         blend_pixel16(dst, src, alpha, mask, mask_linesize, l2depth,
                       left, hband, hsub + vsub, xm);
@@ -602,6 +615,19 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
 {
     int x;
 
+    if (l2depth == 3 && !hsub && !vsub) {
+        /* fast path for full resolution planes and 8-bit masks */
+        mask += xm;
+        for (x = 0; x < w; x++) {
+            if (mask[x]) {
+                unsigned a = mask[x] * alpha;
+                *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+            }
+            dst += dst_delta;
+        }
+        return;
+    }
+
     if (left) {
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
                     left, hband, hsub + vsub, xm);
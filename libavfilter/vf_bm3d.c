@@ -118,7 +118,7 @@ typedef struct BM3DContext {
                           int y, int x, int block_size, float *dst);
     double (*do_block_ssd)(struct BM3DContext *s, PosCode *pos,
                            const uint8_t *src, int src_stride,
-                           int r_y, int r_x);
+                           int r_y, int r_x, double limit);
     void (*do_output)(struct BM3DContext *s, uint8_t *dst, int dst_linesize,
                       int plane, int nb_jobs);
     void (*block_filtering)(struct BM3DContext *s,
@@ -232,20 +232,31 @@ static int cmp_scores(const void *a, const void *b)
     return FFDIFFSIGN(pair1->score, pair2->score);
 }
 
-static double do_block_ssd(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride, int r_y, int r_x)
+/**
+ * Compute the SSD between two blocks. The sums are exact in integer
+ * arithmetic, and the computation stops once the distance exceeds limit,
+ * as such a block would be rejected anyway.
+ */
+static double do_block_ssd(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride, int r_y, int r_x, double limit)
 {
     const uint8_t *srcp = src + pos->y * src_stride + pos->x;
     const uint8_t *refp = src + r_y * src_stride + r_x;
     const int block_size = s->block_size;
-    double dist = 0.;
+    int64_t dist = 0;
     int x, y;
 
     for (y = 0; y < block_size; y++) {
+        int sum = 0;
+
         for (x = 0; x < block_size; x++) {
-            double temp = refp[x] - srcp[x];
-            dist += temp * temp;
+            const int temp = refp[x] - srcp[x];
+            sum += temp * temp;
         }
 
+        dist += sum;
+        if (dist > limit)
+            break;
+
         srcp += src_stride;
         refp += src_stride;
     }
@@ -253,20 +264,26 @@ static double do_block_ssd(BM3DContext *s, PosCode *pos, const uint8_t *src, int
     return dist;
 }
 
-static double do_block_ssd16(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride, int r_y, int r_x)
+static double do_block_ssd16(BM3DContext *s, PosCode *pos, const uint8_t *src, int src_stride, int r_y, int r_x, double limit)
 {
     const uint16_t *srcp = (uint16_t *)src + pos->y * src_stride / 2 + pos->x;
     const uint16_t *refp = (uint16_t *)src + r_y * src_stride / 2 + r_x;
     const int block_size = s->block_size;
-    double dist = 0.;
+    int64_t dist = 0;
     int x, y;
 
     for (y = 0; y < block_size; y++) {
+        int64_t sum = 0;
+
         for (x = 0; x < block_size; x++) {
-            double temp = refp[x] - srcp[x];
-            dist += temp * temp;
+            const int64_t temp = refp[x] - srcp[x];
+            sum += temp * temp;
         }
 
+        dist += sum;
+        if (dist > limit)
+            break;
+
         srcp += src_stride / 2;
         refp += src_stride / 2;
     }
@@ -288,7 +305,7 @@ static void do_block_matching_multi(BM3DContext *s, const uint8_t *src, int src_
         PosCode pos = search_pos[i];
         double dist;
 
-        dist = s->do_block_ssd(s, &pos, src, src_stride, r_y, r_x);
+        dist = s->do_block_ssd(s, &pos, src, src_stride, r_y, r_x, th_sse);
 
         // Only match similar blocks but not identical blocks
         if (dist <= th_sse && dist != 0) {
@@ -81,6 +81,7 @@ static const AVOption deshake_options[] = {
     { "search",  "set search strategy", OFFSET(search), AV_OPT_TYPE_INT, {.i64=EXHAUSTIVE}, EXHAUSTIVE, SEARCH_COUNT-1, FLAGS, "smode" },
         { "exhaustive", "exhaustive search",      0, AV_OPT_TYPE_CONST, {.i64=EXHAUSTIVE},       INT_MIN, INT_MAX, FLAGS, "smode" },
         { "less",       "less exhaustive search", 0, AV_OPT_TYPE_CONST, {.i64=SMART_EXHAUSTIVE}, INT_MIN, INT_MAX, FLAGS, "smode" },
+        { "pyramid",    "coarse-to-fine search",  0, AV_OPT_TYPE_CONST, {.i64=PYRAMID},          INT_MIN, INT_MAX, FLAGS, "smode" },
     { "filename", "set motion search detailed log file name", OFFSET(filename), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
     { "opencl", "ignored",                              OFFSET(opencl), AV_OPT_TYPE_BOOL, {.i64=0}, 0, 1, .flags = FLAGS },
     { NULL }
@@ -163,6 +164,38 @@ static void find_block_motion(DeshakeContext *deshake, uint8_t *src1,
                 if (x == tmp && y == tmp2)
                     continue;
 
+                diff = CMP(cx - x, cy - y);
+                if (diff < smallest) {
+                    smallest = diff;
+                    mv->x = x;
+                    mv->y = y;
+                }
+            }
+        }
+    } else if (deshake->search == PYRAMID) {
+        // Search every position on the half resolution images
+        const int hs = deshake->half_stride;
+        const uint8_t *h1 = deshake->half[0] + (cy >> 1) * hs + (cx >> 1);
+        const uint8_t *h2 = deshake->half[1] + (cy >> 1) * hs + (cx >> 1);
+
+        for (y = -(deshake->ry >> 1); y <= deshake->ry >> 1; y++) {
+            for (x = -(deshake->rx >> 1); x <= deshake->rx >> 1; x++) {
+                diff = deshake->sad_half(h1, hs, h2 - y * hs - x, hs);
+                if (diff < smallest) {
+                    smallest = diff;
+                    mv->x = x;
+                    mv->y = y;
+                }
+            }
+        }
+
+        // Refine the scaled up match at full resolution
+        tmp  = mv->x * 2;
+        tmp2 = mv->y * 2;
+        smallest = INT_MAX;
+
+        for (y = FFMAX(tmp2 - 1, -deshake->ry); y <= FFMIN(tmp2 + 1, deshake->ry); y++) {
+            for (x = FFMAX(tmp - 1, -deshake->rx); x <= FFMIN(tmp + 1, deshake->rx); x++) {
                 diff = CMP(cx - x, cy - y);
                 if (diff < smallest) {
                     smallest = diff;
@@ -225,6 +258,58 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
            diff;
 }
 
+typedef struct ThreadData {
+    uint8_t *src1, *src2;
+    int stride;
+    int nb_blocks_x, nb_blocks_y;
+} ThreadData;
+
+static int find_motion_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DeshakeContext *deshake = ctx->priv;
+    ThreadData *td = arg;
+    const int slice_start = (td->nb_blocks_y *  jobnr     ) / nb_jobs;
+    const int slice_end   = (td->nb_blocks_y * (jobnr + 1)) / nb_jobs;
+    int bx, by;
+
+    for (by = slice_start; by < slice_end; by++) {
+        const int y = deshake->ry + by * deshake->blocksize * 2;
+
+        for (bx = 0; bx < td->nb_blocks_x; bx++) {
+            const int x = deshake->rx + bx * 16;
+            IntMotionVector *mv = &deshake->block_mv[by * td->nb_blocks_x + bx];
+
+            mv->x = mv->y = 0;
+            // If the contrast is too low, just skip this block as it probably
+            // won't be very useful to us.
+            if (block_contrast(td->src2, x, y, td->stride, deshake->blocksize) > deshake->contrast)
+                find_block_motion(deshake, td->src1, td->src2, x, y, td->stride, mv);
+            else
+                mv->x = mv->y = -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Downscale an image by two in both directions, for the coarse pass of the
+ * pyramid search.
+ */
+static void downscale_half(uint8_t *dst, int dst_stride, const uint8_t *src,
+                           int src_stride, int width, int height)
+{
+    int x, y;
+
+    for (y = 0; y < height; y++) {
+        for (x = 0; x < width; x++)
+            dst[x] = (src[2 * x] + src[2 * x + 1] +
+                      src[2 * x + src_stride] + src[2 * x + 1 + src_stride] + 2) >> 2;
+        dst += dst_stride;
+        src += src_stride * 2;
+    }
+}
+
 /**
  * Find the estimated global motion for a scene given the most likely shift
  * for each block in the frame. The global motion is estimated to be the
@@ -232,19 +317,21 @@ static double block_angle(int x, int y, int cx, int cy, IntMotionVector *shift)
  * move one pixel to the right and two pixels down, this would yield a
  * motion vector (1, -2).
  */
-static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
-                        int width, int height, int stride, Transform *t)
+static int find_motion(AVFilterContext *ctx, uint8_t *src1, uint8_t *src2,
+                       int width, int height, int stride, Transform *t)
 {
-    int x, y;
-    IntMotionVector mv = {0, 0};
+    DeshakeContext *deshake = ctx->priv;
+    ThreadData td;
+    int x, y, bx, by, i;
     int count_max_value = 0;
-    int contrast;
 
     int pos;
     int center_x = 0, center_y = 0;
     double p_x, p_y;
 
     av_fast_malloc(&deshake->angles, &deshake->angles_size, width * height / (16 * deshake->blocksize) * sizeof(*deshake->angles));
+    if (!deshake->angles)
+        return AVERROR(ENOMEM);
 
     // Reset counts to zero
     for (x = 0; x < deshake->rx * 2 + 1; x++) {
@@ -253,25 +340,54 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
         }
     }
 
+    td.src1        = src1;
+    td.src2        = src2;
+    td.stride      = stride;
+    td.nb_blocks_x = FFMAX((width  - deshake->rx * 2 - 16 + 15) / 16, 0);
+    td.nb_blocks_y = FFMAX((height - deshake->ry * 2 - 1) / (deshake->blocksize * 2), 0);
+
+    av_fast_malloc(&deshake->block_mv, &deshake->block_mv_size,
+                   td.nb_blocks_x * td.nb_blocks_y * sizeof(*deshake->block_mv));
+    if (!deshake->block_mv)
+        return AVERROR(ENOMEM);
+
+    if (deshake->search == PYRAMID) {
+        // The padding rows cover the 8 lines read by the SAD on the last block row
+        const int half_w = width >> 1, half_h = (height >> 1) + 8;
+
+        deshake->half_stride = FFALIGN(half_w, 16);
+        for (i = 0; i < 2; i++) {
+            av_fast_malloc(&deshake->half[i], &deshake->half_size[i],
+                           deshake->half_stride * half_h);
+            if (!deshake->half[i])
+                return AVERROR(ENOMEM);
+            downscale_half(deshake->half[i], deshake->half_stride,
+                           i ? src2 : src1, stride, half_w, height >> 1);
+            memset(deshake->half[i] + (height >> 1) * deshake->half_stride, 0,
+                   deshake->half_stride * 8);
+        }
+    }
+
+    // Find motion for every block, one row of blocks per job at least
+    if (td.nb_blocks_y)
+        ctx->internal->execute(ctx, find_motion_slice, &td, NULL,
+                               FFMIN(td.nb_blocks_y, ff_filter_get_nb_threads(ctx)));
+
     pos = 0;
-    // Find motion for every block and store the motion vector in the counts
-    for (y = deshake->ry; y < height - deshake->ry - (deshake->blocksize * 2); y += deshake->blocksize * 2) {
-        // We use a width of 16 here to match the sad function
-        for (x = deshake->rx; x < width - deshake->rx - 16; x += 16) {
-            // If the contrast is too low, just skip this block as it probably
-            // won't be very useful to us.
-            contrast = block_contrast(src2, x, y, stride, deshake->blocksize);
-            if (contrast > deshake->contrast) {
-                //av_log(NULL, AV_LOG_ERROR, "%d\n", contrast);
-                find_block_motion(deshake, src1, src2, x, y, stride, &mv);
-                if (mv.x != -1 && mv.y != -1) {
-                    deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
-                    if (x > deshake->rx && y > deshake->ry)
-                        deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
-
-                    center_x += mv.x;
-                    center_y += mv.y;
-                }
+    // Store the motion vector of every block in the counts
+    for (by = 0; by < td.nb_blocks_y; by++) {
+        y = deshake->ry + by * deshake->blocksize * 2;
+        for (bx = 0; bx < td.nb_blocks_x; bx++) {
+            IntMotionVector mv = deshake->block_mv[by * td.nb_blocks_x + bx];
+
+            x = deshake->rx + bx * 16;
+            if (mv.x != -1 && mv.y != -1) {
+                deshake->counts[mv.x + deshake->rx][mv.y + deshake->ry] += 1;
+                if (x > deshake->rx && y > deshake->ry)
+                    deshake->angles[pos++] = block_angle(x, y, 0, 0, &mv);
+
+                center_x += mv.x;
+                center_y += mv.y;
             }
         }
     }
@@ -310,6 +426,7 @@ static void find_motion(DeshakeContext *deshake, uint8_t *src1, uint8_t *src2,
     t->angle = av_clipf(t->angle, -0.1, 0.1);
 
     //av_log(NULL, AV_LOG_ERROR, "%d x %d\n", avg->x, avg->y);
+    return 0;
 }
 
 static int deshake_transform_c(AVFilterContext *ctx,
@@ -403,6 +520,11 @@ static av_cold void uninit(AVFilterContext *ctx)
     av_frame_free(&deshake->ref);
     av_freep(&deshake->angles);
     deshake->angles_size = 0;
+    av_freep(&deshake->block_mv);
+    deshake->block_mv_size = 0;
+    av_freep(&deshake->half[0]);
+    av_freep(&deshake->half[1]);
+    deshake->half_size[0] = deshake->half_size[1] = 0;
     if (deshake->fp)
         fclose(deshake->fp);
 }
@@ -434,10 +556,15 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
     deshake->sad = av_pixelutils_get_sad_fn(4, 4, aligned, deshake); // 16x16, 2nd source unaligned
     if (!deshake->sad)
         return AVERROR(EINVAL);
+    if (deshake->search == PYRAMID) {
+        deshake->sad_half = av_pixelutils_get_sad_fn(3, 3, 0, deshake); // 8x8, unaligned
+        if (!deshake->sad_half)
+            return AVERROR(EINVAL);
+    }
 
     if (deshake->cx < 0 || deshake->cy < 0 || deshake->cw < 0 || deshake->ch < 0) {
         // Find the most likely global motion for the current frame
-        find_motion(deshake, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
+        ret = find_motion(link->dst, (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0], in->data[0], link->w, link->h, in->linesize[0], &t);
     } else {
         uint8_t *src1 = (deshake->ref == NULL) ? in->data[0] : deshake->ref->data[0];
         uint8_t *src2 = in->data[0];
@@ -454,9 +581,12 @@ static int filter_frame(AVFilterLink *link, AVFrame *in)
         src1 += deshake->cy * in->linesize[0] + deshake->cx;
         src2 += deshake->cy * in->linesize[0] + deshake->cx;
 
-        find_motion(deshake, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+        ret = find_motion(link->dst, src1, src2, deshake->cw, deshake->ch, in->linesize[0], &t);
+    }
+    if (ret < 0) {
+        av_frame_free(&in);
+        goto fail;
     }
-
 
     // Copy transform so we can output it later to compare to the smoothed value
     orig.vec.x = t.vec.x;
@@ -560,4 +690,5 @@ AVFilter ff_vf_deshake = {
     .inputs        = deshake_inputs,
     .outputs       = deshake_outputs,
     .priv_class    = &deshake_class,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -140,6 +140,18 @@ enum expansion_mode {
     EXP_STRFTIME,
 };
 
+/**
+ * 8-bit alpha mask holding a whole rendered text, positioned relatively
+ * to the text origin.
+ */
+typedef struct TextMask {
+    uint8_t *buf;
+    unsigned int buf_size;
+    int linesize;
+    int x, y;                       ///< offset of the mask from the text origin
+    int w, h;
+} TextMask;
+
 typedef struct DrawTextContext {
     const AVClass *class;
     int exp_mode;                   ///< expansion mode to use for the text
@@ -203,6 +215,12 @@ typedef struct DrawTextContext {
     int text_shaping;               ///< 1 to shape the text before drawing it
 #endif
     AVDictionary *metadata;
+
+    /* pre-rendered text, reused as long as the expanded text does not change */
+    TextMask text_mask;             ///< alpha mask of the glyphs, also used for the shadow
+    TextMask border_mask;           ///< alpha mask of the glyph borders
+    char *mask_text;                ///< text the masks were rendered for
+    unsigned int mask_fontsize;     ///< font size the masks were rendered with
 } DrawTextContext;
 
 #define OFFSET(x) offsetof(DrawTextContext, x)
@@ -823,6 +841,11 @@ static av_cold void uninit(AVFilterContext *ctx)
 
     av_bprint_finalize(&s->expanded_text, NULL);
     av_bprint_finalize(&s->expanded_fontcolor, NULL);
+
+    av_freep(&s->text_mask.buf);
+    av_freep(&s->border_mask.buf);
+    s->text_mask.buf_size = s->border_mask.buf_size = 0;
+    av_freep(&s->mask_text);
 }
 
 static int config_input(AVFilterLink *inlink)
@@ -1213,19 +1236,20 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+/**
+ * Render all the glyphs of the expanded text into a single alpha mask,
+ * so that they can be blended onto the frame in one go.
+ */
+static int render_text_mask(DrawTextContext *s, TextMask *mask, int borderw)
 {
     char *text = s->expanded_text.str;
     uint32_t code = 0;
-    int i, x1, y1;
+    int i, x, y, x_min = INT_MAX, y_min = INT_MAX, x_max = INT_MIN, y_max = INT_MIN;
     uint8_t *p;
     Glyph *glyph = NULL;
 
     for (i = 0, p = text; *p; i++) {
-        FT_Bitmap bitmap;
+        FT_Bitmap *bitmap;
         Glyph dummy = { 0 };
         GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
 continue_on_invalid:
@@ -1238,26 +1262,141 @@ continue_on_invalid:
         dummy.fontsize = s->fontsize;
         glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
 
-        bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
+        bitmap = borderw ? &glyph->border_bitmap : &glyph->bitmap;
 
         if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
             glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
             return AVERROR(EINVAL);
 
-        x1 = s->positions[i].x+s->x+x - borderw;
-        y1 = s->positions[i].y+s->y+y - borderw;
+        if (!bitmap->width || !bitmap->rows)
+            continue;
+
+        x = s->positions[i].x - borderw;
+        y = s->positions[i].y - borderw;
+        x_min = FFMIN(x_min, x);
+        y_min = FFMIN(y_min, y);
+        x_max = FFMAX(x_max, x + (int)bitmap->width);
+        y_max = FFMAX(y_max, y + (int)bitmap->rows);
+    }
+
+    if (x_min >= x_max || y_min >= y_max) {
+        mask->x = mask->y = mask->w = mask->h = 0;
+        return 0;
+    }
+
+    mask->x = x_min;
+    mask->y = y_min;
+    mask->w = x_max - x_min;
+    mask->h = y_max - y_min;
+    mask->linesize = FFALIGN(mask->w, 32);
+    av_fast_malloc(&mask->buf, &mask->buf_size, (size_t)mask->linesize * mask->h);
+    if (!mask->buf)
+        return AVERROR(ENOMEM);
+    memset(mask->buf, 0, (size_t)mask->linesize * mask->h);
 
-        ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
-                      bitmap.buffer, bitmap.pitch,
-                      bitmap.width, bitmap.rows,
-                      bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
-                      0, x1, y1);
+    for (i = 0, p = text; *p; i++) {
+        FT_Bitmap *bitmap;
+        Glyph dummy = { 0 };
+        const uint8_t *src;
+        uint8_t *dst;
+        GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid2;);
+continue_on_invalid2:
+
+        if (code == '\n' || code == '\r' || code == '\t')
+            continue;
+
+        dummy.code = code;
+        dummy.fontsize = s->fontsize;
+        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
+
+        bitmap = borderw ? &glyph->border_bitmap : &glyph->bitmap;
+        src = bitmap->buffer;
+        dst = mask->buf + (s->positions[i].y - borderw - mask->y) * mask->linesize
+                        + (s->positions[i].x - borderw - mask->x);
+
+        /* accumulate overlapping glyphs the way successive blends would */
+        for (y = 0; y < bitmap->rows; y++) {
+            for (x = 0; x < bitmap->width; x++) {
+                unsigned v = bitmap->pixel_mode == FT_PIXEL_MODE_MONO ?
+                             (src[x >> 3] >> (7 - (x & 7)) & 1) * 255 : src[x];
+                dst[x] += v - dst[x] * v / 255;
+            }
+            src += bitmap->pitch;
+            dst += mask->linesize;
+        }
     }
 
     return 0;
 }
 
+typedef struct ThreadData {
+    AVFrame *frame;
+    FFDrawColor *fontcolor;
+    FFDrawColor *shadowcolor;
+    FFDrawColor *bordercolor;
+    FFDrawColor *boxcolor;
+    int box_w, box_h;
+    int y_start, y_end;             ///< rows of the frame touched by the text
+} ThreadData;
+
+static void blend_text_mask(DrawTextContext *s, AVFrame *frame,
+                            FFDrawColor *color, const TextMask *mask,
+                            int x, int y, int slice_start, int slice_end)
+{
+    int row_start, row_end;
+
+    x += mask->x;
+    y += mask->y;
+    row_start = FFMAX(slice_start - y, 0);
+    row_end   = FFMIN(slice_end   - y, mask->h);
+    if (row_start >= row_end || !mask->w)
+        return;
+
+    ff_blend_mask(&s->dc, color,
+                  frame->data, frame->linesize, frame->width, slice_end,
+                  mask->buf + row_start * mask->linesize, mask->linesize,
+                  mask->w, row_end - row_start, 3, 0, x, y + row_start);
+}
+
+static int draw_text_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    const int h = td->y_end - td->y_start;
+    /* slice boundaries must not share chroma rows */
+    const int slice_start = ff_draw_round_to_sub(&s->dc, 1, -1, td->y_start + (h *  jobnr     ) / nb_jobs);
+    const int slice_end   = jobnr == nb_jobs - 1 ? td->y_end :
+                            ff_draw_round_to_sub(&s->dc, 1, -1, td->y_start + (h * (jobnr + 1)) / nb_jobs);
+
+    if (slice_start >= slice_end)
+        return 0;
+
+    if (s->draw_box) {
+        int box_y = FFMAX(s->y - s->boxborderw, slice_start);
+        int box_h = FFMIN(s->y - s->boxborderw + td->box_h + s->boxborderw * 2, slice_end) - box_y;
+
+        if (box_h > 0)
+            ff_blend_rectangle(&s->dc, td->boxcolor,
+                               frame->data, frame->linesize, frame->width, slice_end,
+                               s->x - s->boxborderw, box_y,
+                               td->box_w + s->boxborderw * 2, box_h);
+    }
+
+    if (s->shadowx || s->shadowy)
+        blend_text_mask(s, frame, td->shadowcolor, &s->text_mask,
+                        s->x + s->shadowx, s->y + s->shadowy, slice_start, slice_end);
+
+    if (s->borderw)
+        blend_text_mask(s, frame, td->bordercolor, &s->border_mask,
+                        s->x, s->y, slice_start, slice_end);
+
+    blend_text_mask(s, frame, td->fontcolor, &s->text_mask,
+                    s->x, s->y, slice_start, slice_end);
+
+    return 0;
+}
+
 
 static void update_color_with_alpha(DrawTextContext *s, FFDrawColor *color, const FFDrawColor incolor)
 {
@@ -1298,6 +1437,7 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     FT_Vector delta;
     Glyph *glyph = NULL, *prev_glyph = NULL;
     Glyph dummy = { 0 };
+    ThreadData td;
 
     time_t now = time(0);
     struct tm ltime;
@@ -1478,27 +1618,44 @@ continue_on_invalid2:
             s->y = FFMAX(height - box_h - offsetbottom, 0);
     }
 
-    /* draw box */
-    if (s->draw_box)
-        ff_blend_rectangle(&s->dc, &boxcolor,
-                           frame->data, frame->linesize, width, height,
-                           s->x - s->boxborderw, s->y - s->boxborderw,
-                           box_w + s->boxborderw * 2, box_h + s->boxborderw * 2);
-
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
+    /* render the text masks, unless the text did not change since the last frame */
+    if (!s->mask_text || s->mask_fontsize != s->fontsize || strcmp(s->mask_text, text)) {
+        av_freep(&s->mask_text);
+        if ((ret = render_text_mask(s, &s->text_mask, 0)) < 0)
+            return ret;
+        if (s->borderw && (ret = render_text_mask(s, &s->border_mask, s->borderw)) < 0)
             return ret;
+        if (!(s->mask_text = av_strdup(text)))
+            return AVERROR(ENOMEM);
+        s->mask_fontsize = s->fontsize;
     }
 
+    td.frame       = frame;
+    td.fontcolor   = &fontcolor;
+    td.shadowcolor = &shadowcolor;
+    td.bordercolor = &bordercolor;
+    td.boxcolor    = &boxcolor;
+    td.box_w       = box_w;
+    td.box_h       = box_h;
+
+    /* vertical extent of everything drawn, so that all the jobs get some work */
+    y_min = s->y + FFMIN(s->text_mask.y, s->text_mask.y + s->shadowy);
+    y_max = s->y + FFMAX(s->text_mask.y, s->text_mask.y + s->shadowy) + s->text_mask.h;
     if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
+        y_min = FFMIN(y_min, s->y + s->border_mask.y);
+        y_max = FFMAX(y_max, s->y + s->border_mask.y + s->border_mask.h);
     }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &fontcolor, 0, 0, 0)) < 0)
-        return ret;
+    if (s->draw_box) {
+        y_min = FFMIN(y_min, s->y - s->boxborderw);
+        y_max = FFMAX(y_max, s->y + box_h + s->boxborderw);
+    }
+    td.y_start = av_clip(y_min, 0, height);
+    td.y_end   = av_clip(y_max, 0, height);
+
+    if (td.y_start < td.y_end)
+        ctx->internal->execute(ctx, draw_text_slice, &td, NULL,
+                               FFMIN(FFMAX((td.y_end - td.y_start) >> s->dc.vsub_max, 1),
+                                     ff_filter_get_nb_threads(ctx)));
 
     return 0;
 }
@@ -1574,5 +1731,5 @@ AVFilter ff_vf_drawtext = {
     .inputs        = avfilter_vf_drawtext_inputs,
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
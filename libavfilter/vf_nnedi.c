@@ -43,8 +43,9 @@ typedef struct FrameData {
     int field[3];
 
     int32_t *lcount[3];
-    float *input;
-    float *temp;
+    float *input;               ///< per-thread input buffers, 512 floats each
+    float *temp;                ///< per-thread scratch buffers, temp_size bytes each
+    size_t temp_size;
 } FrameData;
 
 typedef struct NNEDIContext {
@@ -60,6 +61,7 @@ typedef struct NNEDIContext {
 
     AVFloatDSPContext *fdsp;
     int nb_planes;
+    int nb_threads;
     int linesize[4];
     int planeheight[4];
 
@@ -84,8 +86,8 @@ typedef struct NNEDIContext {
     int max_value;
 
     void (*copy_pad)(const AVFrame *, FrameData *, struct NNEDIContext *, int);
-    void (*evalfunc_0)(struct NNEDIContext *, FrameData *);
-    void (*evalfunc_1)(struct NNEDIContext *, FrameData *);
+    void (*evalfunc_0)(struct NNEDIContext *, FrameData *, int, int);
+    void (*evalfunc_1)(struct NNEDIContext *, FrameData *, int, int);
 
     // Functions used in evalfunc_0
     void (*readpixels)(const uint8_t *, const int, float *);
@@ -161,6 +163,8 @@ static int config_input(AVFilterLink *inlink)
     s->planeheight[1] = s->planeheight[2] = AV_CEIL_RSHIFT(inlink->h, desc->log2_chroma_h);
     s->planeheight[0] = s->planeheight[3] = inlink->h;
 
+    s->nb_threads = ff_filter_get_nb_threads(ctx);
+
     return 0;
 }
 
@@ -415,11 +419,22 @@ static void compute_network0new(NNEDIContext *s, const float *datai, const float
     ((int *)d)[0] = mask;
 }
 
-static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
+/**
+ * Return the first line of the given parity in the slice of lines
+ * [jobnr * h / nb_jobs; (jobnr + 1) * h / nb_jobs[.
+ */
+static int slice_first_line(int h, int parity, int jobnr, int nb_jobs)
+{
+    const int start = (h * jobnr) / nb_jobs;
+
+    return start + ((start + parity) & 1);
+}
+
+static void evalfunc_0(NNEDIContext *s, FrameData *frame_data, int jobnr, int nb_jobs)
 {
-    float *input = frame_data->input;
+    float *input = frame_data->input + jobnr * 512;
     const float *weights0 = s->weights0;
-    float *temp = frame_data->temp;
+    float *temp = (float *)((uint8_t *)frame_data->temp + jobnr * frame_data->temp_size);
     uint8_t *tempu = (uint8_t *)temp;
     int plane, x, y;
 
@@ -433,6 +448,7 @@ static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
 
         uint8_t *dstp = (uint8_t *)frame_data->dstp[plane];
         const int dst_stride = frame_data->dst_stride[plane] / sizeof(uint8_t);
+        const int slice_end = ((height - 12) * (jobnr + 1)) / nb_jobs;
         const uint8_t *src3p;
         int ystart, ystop;
         int32_t *lcount;
@@ -440,15 +456,16 @@ static void evalfunc_0(NNEDIContext *s, FrameData *frame_data)
         if (!(s->process_plane & (1 << plane)))
             continue;
 
-        for (y = 1 - frame_data->field[plane]; y < height - 12; y += 2) {
+        for (y = slice_first_line(height - 12, 1 - frame_data->field[plane], jobnr, nb_jobs);
+             y < slice_end; y += 2) {
             memcpy(dstp + y * dst_stride,
                    srcp + 32 + (6 + y) * src_stride,
                    (width - 64) * sizeof(uint8_t));
 
         }
 
-        ystart = 6 + frame_data->field[plane];
-        ystop = height - 6;
+        ystart = 6 + slice_first_line(height - 12, frame_data->field[plane], jobnr, nb_jobs);
+        ystop = 6 + slice_end;
         srcp += ystart * src_stride;
         dstp += (ystart - 6) * dst_stride - 32;
         src3p = srcp - src_stride * 3;
@@ -575,10 +592,10 @@ static void weighted_avg_elliott_mul5_m16(const float *w, const int n, float *ms
 }
 
 
-static void evalfunc_1(NNEDIContext *s, FrameData *frame_data)
+static void evalfunc_1(NNEDIContext *s, FrameData *frame_data, int jobnr, int nb_jobs)
 {
-    float *input = frame_data->input;
-    float *temp = frame_data->temp;
+    float *input = frame_data->input + jobnr * 512;
+    float *temp = (float *)((uint8_t *)frame_data->temp + jobnr * frame_data->temp_size);
     float **weights1 = s->weights1;
     const int qual = s->qual;
     const int asize = s->asize;
@@ -599,8 +616,8 @@ static void evalfunc_1(NNEDIContext *s, FrameData *frame_data)
         uint8_t *dstp = (uint8_t *)frame_data->dstp[plane];
         const int dst_stride = frame_data->dst_stride[plane] / sizeof(uint8_t);
 
-        const int ystart = frame_data->field[plane];
-        const int ystop = height - 12;
+        const int ystart = slice_first_line(height - 12, frame_data->field[plane], jobnr, nb_jobs);
+        const int ystop = ((height - 12) * (jobnr + 1)) / nb_jobs;
         const uint8_t *srcpp;
 
         if (!(s->process_plane & (1 << plane)))
@@ -686,6 +703,20 @@ static int modnpf(const int m, const int n)
     return m + n - (m % n);
 }
 
+static int filter_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    NNEDIContext *s = ctx->priv;
+    FrameData *frame_data = arg;
+
+    // Handles prescreening and the cubic interpolation.
+    s->evalfunc_0(s, frame_data, jobnr, nb_jobs);
+
+    // The rest.
+    s->evalfunc_1(s, frame_data, jobnr, nb_jobs);
+
+    return 0;
+}
+
 static int get_frame(AVFilterContext *ctx, int is_second)
 {
     NNEDIContext *s = ctx->priv;
@@ -766,27 +797,27 @@ static int get_frame(AVFilterContext *ctx, int is_second)
     }
 
     if (!frame_data->input) {
-        frame_data->input = av_malloc(512 * sizeof(float));
+        frame_data->input = av_malloc_array(s->nb_threads, 512 * sizeof(float));
         if (!frame_data->input)
             return AVERROR(ENOMEM);
     }
     // evalfunc_0 requires at least padded_width[0] bytes.
     // evalfunc_1 requires at least 512 floats.
     if (!frame_data->temp) {
-        temp_size = FFMAX(frame_data->padded_width[0], 512 * sizeof(float));
-        frame_data->temp = av_malloc(temp_size);
+        temp_size = FFALIGN(FFMAX(frame_data->padded_width[0], 512 * sizeof(float)), 32);
+        frame_data->temp = av_malloc_array(s->nb_threads, temp_size);
         if (!frame_data->temp)
             return AVERROR(ENOMEM);
+        frame_data->temp_size = temp_size;
     }
 
     // Copy src to a padded "frame" in frame_data and mirror the edges.
     s->copy_pad(src, frame_data, s, field_n);
 
-    // Handles prescreening and the cubic interpolation.
-    s->evalfunc_0(s, frame_data);
-
-    // The rest.
-    s->evalfunc_1(s, frame_data);
+    // Every job handles a band of lines of each plane, the lines
+    // computed by the two passes only depend on the padded source.
+    ctx->internal->execute(ctx, filter_slice, frame_data, NULL,
+                           FFMIN(s->planeheight[1], s->nb_threads));
 
     return 0;
 }
@@ -1207,5 +1238,5 @@ AVFilter ff_vf_nnedi = {
     .query_formats = query_formats,
     .inputs        = inputs,
     .outputs       = outputs,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_INTERNAL | AVFILTER_FLAG_SLICE_THREADS,
 };
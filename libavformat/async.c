@@ -1,5 +1,5 @@
 /*
- * Input async protocol.
+ * Input and output async protocol.
  * Copyright (c) 2015 Zhang Rui <bbcallen@gmail.com>
  *
  * This file is part of FFmpeg.
@@ -31,6 +31,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/error.h"
 #include "libavutil/fifo.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/log.h"
 #include "libavutil/opt.h"
 #include "libavutil/thread.h"
@@ -44,6 +45,7 @@
 #define BUFFER_CAPACITY         (4 * 1024 * 1024)
 #define READ_BACK_CAPACITY      (4 * 1024 * 1024)
 #define SHORT_SEEK_THRESHOLD    (256 * 1024)
+#define WRITE_CHUNK_SIZE        (64 * 1024)
 
 typedef struct RingBuffer
 {
@@ -78,6 +80,12 @@ typedef struct Context {
 
     int             abort_request;
     AVIOInterruptCB interrupt_callback;
+
+    /* write-behind */
+    int             write_buffer_size;
+    int             close_request;
+    uint8_t        *write_chunk;
+    int             write_chunk_size;
 } Context;
 
 static int ring_init(RingBuffer *ring, unsigned int capacity, int read_back_capacity)
@@ -237,6 +245,65 @@ static void *async_buffer_task(void *arg)
     return NULL;
 }
 
+/**
+ * Drain the ring to the inner protocol. The data is copied out in chunks
+ * and only dropped from the ring once written, so an empty ring means
+ * that everything reached the inner protocol.
+ */
+static void *async_write_task(void *arg)
+{
+    URLContext   *h    = arg;
+    Context      *c    = h->priv_data;
+    RingBuffer   *ring = &c->ring;
+    int           ret;
+
+    while (1) {
+        int to_copy, header_size;
+
+        pthread_mutex_lock(&c->mutex);
+        if (async_check_interrupt(h)) {
+            c->io_error = AVERROR_EXIT;
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_mutex_unlock(&c->mutex);
+            break;
+        }
+
+        to_copy = c->io_error ? 0 : FFMIN(c->write_chunk_size, ring_size(ring));
+        if (!to_copy) {
+            if (c->close_request) {
+                pthread_mutex_unlock(&c->mutex);
+                break;
+            }
+            pthread_cond_signal(&c->cond_wakeup_main);
+            pthread_cond_wait(&c->cond_wakeup_background, &c->mutex);
+            pthread_mutex_unlock(&c->mutex);
+            continue;
+        }
+        /* the size header is dropped together with its packet */
+        header_size = 0;
+        if (h->max_packet_size) {
+            uint8_t size_buf[4];
+            av_fifo_generic_peek(ring->fifo, size_buf, 4, NULL);
+            to_copy     = AV_RN32(size_buf);
+            header_size = 4;
+        }
+        av_fifo_generic_peek_at(ring->fifo, c->write_chunk, header_size, to_copy, NULL);
+        pthread_mutex_unlock(&c->mutex);
+
+        ret = ffurl_write(c->inner, c->write_chunk, to_copy);
+
+        pthread_mutex_lock(&c->mutex);
+        if (ret < 0)
+            c->io_error = ret;
+        else
+            av_fifo_drain(ring->fifo, header_size + to_copy);
+        pthread_cond_signal(&c->cond_wakeup_main);
+        pthread_mutex_unlock(&c->mutex);
+    }
+
+    return NULL;
+}
+
 static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **options)
 {
     Context         *c = h->priv_data;
@@ -245,9 +312,16 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
 
     av_strstart(arg, "async:", &arg);
 
-    ret = ring_init(&c->ring, BUFFER_CAPACITY, READ_BACK_CAPACITY);
-    if (ret < 0)
-        goto fifo_fail;
+    if ((flags & AVIO_FLAG_READ_WRITE) == AVIO_FLAG_READ_WRITE) {
+        av_log(h, AV_LOG_ERROR, "Simultaneous read and write is not supported\n");
+        return AVERROR(ENOSYS);
+    }
+
+    if (!(flags & AVIO_FLAG_WRITE)) {
+        ret = ring_init(&c->ring, BUFFER_CAPACITY, READ_BACK_CAPACITY);
+        if (ret < 0)
+            goto fifo_fail;
+    }
 
     /* wrap interrupt callback */
     c->interrupt_callback = h->interrupt_callback;
@@ -257,6 +331,25 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
         goto url_fail;
     }
 
+    if (flags & AVIO_FLAG_WRITE) {
+        /* Keep the size of the writes for packet based protocols: each write
+         * is stored in the ring with its size and passed on as a whole. */
+        h->min_packet_size  = c->inner->min_packet_size;
+        h->max_packet_size  = c->inner->max_packet_size;
+        c->write_chunk_size = FFMAX(WRITE_CHUNK_SIZE, h->max_packet_size);
+        if (h->max_packet_size)
+            c->write_buffer_size = FFMAX(c->write_buffer_size, c->write_chunk_size + 4);
+
+        c->write_chunk = av_malloc(c->write_chunk_size);
+        if (!c->write_chunk) {
+            ret = AVERROR(ENOMEM);
+            goto mutex_fail;
+        }
+        ret = ring_init(&c->ring, c->write_buffer_size, 0);
+        if (ret < 0)
+            goto mutex_fail;
+    }
+
     c->logical_size = ffurl_size(c->inner);
     h->is_streamed  = c->inner->is_streamed;
 
@@ -278,7 +371,8 @@ static int async_open(URLContext *h, const char *arg, int flags, AVDictionary **
         goto cond_wakeup_background_fail;
     }
 
-    ret = pthread_create(&c->async_buffer_thread, NULL, async_buffer_task, h);
+    ret = pthread_create(&c->async_buffer_thread, NULL,
+                         flags & AVIO_FLAG_WRITE ? async_write_task : async_buffer_task, h);
     if (ret) {
         av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(ret));
         goto thread_fail;
@@ -297,6 +391,7 @@ mutex_fail:
 url_fail:
     ring_destroy(&c->ring);
 fifo_fail:
+    av_freep(&c->write_chunk);
     return ret;
 }
 
@@ -306,7 +401,11 @@ static int async_close(URLContext *h)
     int      ret;
 
     pthread_mutex_lock(&c->mutex);
-    c->abort_request = 1;
+    /* Let the writing thread drain the ring before exiting. */
+    if (h->flags & AVIO_FLAG_WRITE)
+        c->close_request = 1;
+    else
+        c->abort_request = 1;
     pthread_cond_signal(&c->cond_wakeup_background);
     pthread_mutex_unlock(&c->mutex);
 
@@ -319,7 +418,11 @@ static int async_close(URLContext *h)
     pthread_mutex_destroy(&c->mutex);
     ffurl_closep(&c->inner);
     ring_destroy(&c->ring);
+    av_freep(&c->write_chunk);
 
+    /* a latched write error, the read side always ends with AVERROR_EXIT */
+    if ((h->flags & AVIO_FLAG_WRITE) && c->io_error != AVERROR_EXIT)
+        return c->io_error;
     return 0;
 }
 
@@ -375,6 +478,99 @@ static int async_read(URLContext *h, unsigned char *buf, int size)
     return async_read_internal(h, buf, size, 0, NULL);
 }
 
+static int async_write(URLContext *h, const unsigned char *buf, int size)
+{
+    Context      *c        = h->priv_data;
+    RingBuffer   *ring     = &c->ring;
+    int           to_write = size;
+    int           ret      = size;
+
+    if (h->max_packet_size && size > c->write_chunk_size)
+        return AVERROR(EINVAL);
+
+    pthread_mutex_lock(&c->mutex);
+
+    while (to_write > 0) {
+        int to_copy;
+        if (async_check_interrupt(h)) {
+            ret = AVERROR_EXIT;
+            break;
+        }
+        if (c->io_error) {
+            ret = c->io_error;
+            break;
+        }
+        if (h->max_packet_size) {
+            to_copy = ring_space(ring) >= size + 4 ? size : 0;
+            if (to_copy) {
+                uint8_t size_buf[4];
+                AV_WN32(size_buf, size);
+                ring_generic_write(ring, size_buf, 4, NULL);
+            }
+        } else {
+            to_copy = FFMIN(to_write, ring_space(ring));
+        }
+        if (to_copy > 0) {
+            ring_generic_write(ring, (void *)buf, to_copy, NULL);
+            buf            += to_copy;
+            to_write       -= to_copy;
+            c->logical_pos += to_copy;
+            pthread_cond_signal(&c->cond_wakeup_background);
+            continue;
+        }
+        pthread_cond_signal(&c->cond_wakeup_background);
+        pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+    }
+
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
+/**
+ * Wait until everything written so far has been passed to the inner
+ * protocol. On success the mutex is held and the writing thread is idle,
+ * so the inner protocol can be used directly.
+ */
+static int async_write_barrier(URLContext *h)
+{
+    Context *c = h->priv_data;
+
+    pthread_mutex_lock(&c->mutex);
+    while (ring_size(&c->ring) > 0 && !c->io_error) {
+        if (async_check_interrupt(h)) {
+            pthread_mutex_unlock(&c->mutex);
+            return AVERROR_EXIT;
+        }
+        pthread_cond_signal(&c->cond_wakeup_background);
+        pthread_cond_wait(&c->cond_wakeup_main, &c->mutex);
+    }
+    if (c->io_error) {
+        pthread_mutex_unlock(&c->mutex);
+        return c->io_error;
+    }
+    return 0;
+}
+
+static int64_t async_write_seek(URLContext *h, int64_t pos, int whence)
+{
+    Context *c = h->priv_data;
+    int64_t  ret;
+
+    if (whence == SEEK_CUR && !pos)
+        return c->logical_pos;
+
+    ret = async_write_barrier(h);
+    if (ret < 0)
+        return ret;
+    ret = ffurl_seek(c->inner, pos, whence);
+    if (ret >= 0 && whence != AVSEEK_SIZE)
+        c->logical_pos = ret;
+    pthread_mutex_unlock(&c->mutex);
+
+    return ret;
+}
+
 static void fifo_do_not_copy_func(void* dest, void* src, int size) {
     // do not copy
 }
@@ -388,6 +584,9 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
     int fifo_size;
     int fifo_size_of_read_back;
 
+    if (h->flags & AVIO_FLAG_WRITE)
+        return async_write_seek(h, pos, whence);
+
     if (whence == AVSEEK_SIZE) {
         av_log(h, AV_LOG_TRACE, "async_seek: AVSEEK_SIZE: %"PRId64"\n", (int64_t)c->logical_size);
         return c->logical_size;
@@ -464,12 +663,16 @@ static int64_t async_seek(URLContext *h, int64_t pos, int whence)
 
 #define OFFSET(x) offsetof(Context, x)
 #define D AV_OPT_FLAG_DECODING_PARAM
+#define E AV_OPT_FLAG_ENCODING_PARAM
 
 static const AVOption options[] = {
+    { "write_buffer_size", "Amount of data buffered ahead of the output", OFFSET(write_buffer_size),
+      AV_OPT_TYPE_INT, { .i64 = BUFFER_CAPACITY }, 1, INT_MAX / 2, E },
     {NULL},
 };
 
 #undef D
+#undef E
 #undef OFFSET
 
 static const AVClass async_context_class = {
@@ -483,6 +686,7 @@ const URLProtocol ff_async_protocol = {
     .name                = "async",
     .url_open2           = async_open,
     .url_read            = async_read,
+    .url_write           = async_write,
     .url_seek            = async_seek,
     .url_close           = async_close,
     .priv_data_size      = sizeof(Context),
@@ -368,7 +368,7 @@ int ff_avc_decode_sps(H264SPS *sps, const uint8_t *buf, int buf_size)
         sps->profile_idc == 134) {
         sps->chroma_format_idc = get_ue_golomb(&gb); // chroma_format_idc
         if (sps->chroma_format_idc == 3) {
-            skip_bits1(&gb); // separate_colour_plane_flag
+            sps->separate_colour_plane_flag = get_bits1(&gb);
         }
         sps->bit_depth_luma = get_ue_golomb(&gb) + 8;
         sps->bit_depth_chroma = get_ue_golomb(&gb) + 8;
@@ -395,7 +395,7 @@ int ff_avc_decode_sps(H264SPS *sps, const uint8_t *buf, int buf_size)
         sps->bit_depth_chroma = 8;
     }
 
-    get_ue_golomb(&gb); // log2_max_frame_num_minus4
+    sps->log2_max_frame_num = get_ue_golomb(&gb) + 4;
     pic_order_cnt_type = get_ue_golomb(&gb);
 
     if (pic_order_cnt_type == 0) {
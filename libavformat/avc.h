@@ -45,6 +45,8 @@ typedef struct {
     uint8_t bit_depth_luma;
     uint8_t bit_depth_chroma;
     uint8_t frame_mbs_only_flag;
+    uint8_t separate_colour_plane_flag;
+    uint8_t log2_max_frame_num;
     AVRational sar;
 } H264SPS;
 
@@ -1498,6 +1498,12 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_FAST_SEEK   0x80000 ///< Enable fast, but inaccurate seeks for some formats
 #define AVFMT_FLAG_SHORTEST   0x100000 ///< Stop muxing when the shortest stream stops.
 #define AVFMT_FLAG_AUTO_BSF   0x200000 ///< Add bitstream filters as requested by the muxer
+/**
+ * Make avformat_find_stream_info() decode only the streams whose parameters
+ * are not known from the container or the parser, and accept any frame rate
+ * they signal instead of measuring it.
+ */
+#define AVFMT_FLAG_FAST_PROBE 0x400000
 
     /**
      * Maximum size of the data read from input for determining
@@ -44,6 +44,7 @@
 #if CONFIG_HTTP_PROTOCOL
 #include "http.h"
 #endif
+#include "httppool.h"
 #include "internal.h"
 #include "isom.h"
 #include "os_support.h"
@@ -174,6 +175,7 @@ typedef struct DASHContext {
     int hls_playlist;
     const char *hls_master_name;
     int http_persistent;
+    HTTPPool http_pool;
     int master_playlist_created;
     AVIOContext *mpd_out;
     AVIOContext *m3u8_out;
@@ -228,7 +230,9 @@ static int dashenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
     DASHContext *c = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
     int err = AVERROR_MUXER_NOT_FOUND;
-    if (!*pb || !http_base_proto || !c->http_persistent) {
+    if (!*pb && http_base_proto && c->http_persistent) {
+        err = ff_http_pool_open(s, &c->http_pool, pb, filename, options);
+    } else if (!*pb || !http_base_proto || !c->http_persistent) {
         err = s->io_open(s, pb, filename, AVIO_FLAG_WRITE, options);
 #if CONFIG_HTTP_PROTOCOL
     } else {
@@ -251,13 +255,8 @@ static void dashenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filenam
 
     if (!http_base_proto || !c->http_persistent) {
         ff_format_io_close(s, pb);
-#if CONFIG_HTTP_PROTOCOL
     } else {
-        URLContext *http_url_context = ffio_geturlcontext(*pb);
-        av_assert0(http_url_context);
-        avio_flush(*pb);
-        ffurl_shutdown(http_url_context, AVIO_FLAG_WRITE);
-#endif
+        ff_http_pool_release(s, &c->http_pool, pb, 0);
     }
 }
 
@@ -650,6 +649,7 @@ static void dash_free(AVFormatContext *s)
 
     ff_format_io_close(s, &c->mpd_out);
     ff_format_io_close(s, &c->m3u8_out);
+    ff_http_pool_close(s, &c->http_pool);
 }
 
 static void output_segment_list(OutputStream *os, AVIOContext *out, AVFormatContext *s,
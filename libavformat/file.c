@@ -19,6 +19,9 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define _GNU_SOURCE     /* Needed for O_DIRECT, MAP_ANONYMOUS and syscall() with glibc */
+
+#include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
@@ -38,6 +41,20 @@
 #include "os_support.h"
 #include "url.h"
 
+#if HAVE_LINUX_IO_URING_H && HAVE_MMAP
+#include <stdatomic.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define FILE_URING 1
+#endif
+#endif
+#ifndef FILE_URING
+#define FILE_URING 0
+#endif
+
 /* Some systems may not have S_ISFIFO */
 #ifndef S_ISFIFO
 #  ifdef S_IFIFO
@@ -67,6 +84,43 @@
 
 /* standard file protocol */
 
+enum FileIOEngine {
+    FILE_IO_SYNC,
+    FILE_IO_URING,
+};
+
+#define URING_MAX_DEPTH 64
+#define URING_ALIGN     4096 ///< offset and size alignment for O_DIRECT
+
+#if FILE_URING
+typedef struct URingBuffer {
+    uint8_t *data;
+    struct iovec iov;
+    int64_t offset;   ///< file offset of data[0]
+    int size;         ///< bytes read, or negative error code
+    int eof;          ///< a read returned 0 bytes
+    int pending;
+} URingBuffer;
+
+typedef struct URing {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_map, *cq_map;
+    size_t sq_map_size, cq_map_size, sqes_map_size;
+    unsigned sq_local_tail;
+
+    URingBuffer bufs[URING_MAX_DEPTH];
+    uint8_t *buf_map;
+    size_t buf_map_size;
+    int head;          ///< buffer holding the current position
+    int nb_queued;     ///< buffers in the read-ahead window
+    int64_t next_offset;
+} URing;
+#endif
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -74,9 +128,17 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int io_engine;
+    int queue_depth;
+    int io_size;
+    int direct;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
+#if FILE_URING
+    URing *uring;
+    int64_t pos;
+#endif
 } FileContext;
 
 static const AVOption file_options[] = {
@@ -84,6 +146,12 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "io_engine", "set the I/O engine used for reading", offsetof(FileContext, io_engine), AV_OPT_TYPE_INT, { .i64 = FILE_IO_SYNC }, 0, 1, AV_OPT_FLAG_DECODING_PARAM, "io_engine" },
+        { "sync",     "blocking read() calls", 0, AV_OPT_TYPE_CONST, { .i64 = FILE_IO_SYNC },  0, 0, AV_OPT_FLAG_DECODING_PARAM, "io_engine" },
+        { "io_uring", "Linux io_uring with read-ahead", 0, AV_OPT_TYPE_CONST, { .i64 = FILE_IO_URING }, 0, 0, AV_OPT_FLAG_DECODING_PARAM, "io_engine" },
+    { "queue_depth", "set the number of reads in flight with io_uring", offsetof(FileContext, queue_depth), AV_OPT_TYPE_INT, { .i64 = 4 }, 1, URING_MAX_DEPTH, AV_OPT_FLAG_DECODING_PARAM },
+    { "io_size", "set the size of each read with io_uring", offsetof(FileContext, io_size), AV_OPT_TYPE_INT, { .i64 = 256 * 1024 }, URING_ALIGN, 64 * 1024 * 1024, AV_OPT_FLAG_DECODING_PARAM },
+    { "direct", "bypass the page cache (O_DIRECT) with io_uring", offsetof(FileContext, direct), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -106,11 +174,291 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if FILE_URING
+static void uring_free(URing **ring)
+{
+    URing *r = *ring;
+
+    if (!r)
+        return;
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_map_size);
+    if (r->cq_map)
+        munmap(r->cq_map, r->cq_map_size);
+    if (r->sq_map)
+        munmap(r->sq_map, r->sq_map_size);
+    if (r->buf_map)
+        munmap(r->buf_map, r->buf_map_size);
+    if (r->fd >= 0)
+        close(r->fd);
+    av_freep(ring);
+}
+
+static int uring_alloc(URing **ring, int depth, int io_size)
+{
+    struct io_uring_params p = { 0 };
+    uint8_t *sq, *cq;
+    URing *r;
+    int i, ret;
+
+    r = av_mallocz(sizeof(*r));
+    if (!r)
+        return AVERROR(ENOMEM);
+    *ring = r;
+
+    r->fd = syscall(__NR_io_uring_setup, depth, &p);
+    if (r->fd < 0) {
+        ret = AVERROR(errno);
+        goto fail;
+    }
+
+    r->sq_map_size   = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_map_size   = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_map_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->buf_map_size  = (size_t)depth * io_size;
+    r->sq_map  = mmap(NULL, r->sq_map_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    r->cq_map  = mmap(NULL, r->cq_map_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    r->sqes    = mmap(NULL, r->sqes_map_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    /* page aligned, as required by O_DIRECT */
+    r->buf_map = mmap(NULL, r->buf_map_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (r->sq_map == MAP_FAILED || r->cq_map == MAP_FAILED ||
+        r->sqes == MAP_FAILED || r->buf_map == MAP_FAILED) {
+        ret = AVERROR(errno);
+        if (r->sq_map  == MAP_FAILED) r->sq_map  = NULL;
+        if (r->cq_map  == MAP_FAILED) r->cq_map  = NULL;
+        if (r->sqes    == MAP_FAILED) r->sqes    = NULL;
+        if (r->buf_map == MAP_FAILED) r->buf_map = NULL;
+        goto fail;
+    }
+
+    sq = r->sq_map;
+    cq = r->cq_map;
+    r->sq_head  = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail  = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask  = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head  = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail  = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask  = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    r->sq_local_tail = *r->sq_tail;
+    for (i = 0; i < depth; i++)
+        r->bufs[i].data = r->buf_map + (size_t)i * io_size;
+    return 0;
+
+fail:
+    uring_free(ring);
+    return ret;
+}
+
+/**
+ * Queue a read of the part of the buffer which has not been filled yet,
+ * i.e. of the whole buffer if its size is 0.
+ */
+static void uring_queue_read(URing *r, int fd, int idx, int io_size)
+{
+    unsigned slot = r->sq_local_tail++ & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[slot];
+    URingBuffer *b = &r->bufs[idx];
+
+    b->iov.iov_base = b->data + b->size;
+    b->iov.iov_len  = io_size - b->size;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode    = IORING_OP_READV;
+    sqe->fd        = fd;
+    sqe->off       = b->offset + b->size;
+    sqe->addr      = (uintptr_t)&b->iov;
+    sqe->len       = 1;
+    sqe->user_data = idx;
+    r->sq_array[slot] = slot;
+    b->pending = 1;
+}
+
+static int uring_submit(URing *r)
+{
+    unsigned to_submit;
+    int ret;
+
+    /* make the entries visible before the new tail */
+    atomic_store_explicit((_Atomic unsigned *)r->sq_tail, r->sq_local_tail, memory_order_release);
+    to_submit = r->sq_local_tail -
+                atomic_load_explicit((_Atomic unsigned *)r->sq_head, memory_order_acquire);
+    if (!to_submit)
+        return 0;
+    do {
+        ret = syscall(__NR_io_uring_enter, r->fd, to_submit, 0, 0, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    return ret < 0 ? AVERROR(errno) : 0;
+}
+
+static int uring_wait(URing *r, URingBuffer *b)
+{
+    while (b->pending) {
+        unsigned head = *r->cq_head;
+        unsigned tail = atomic_load_explicit((_Atomic unsigned *)r->cq_tail, memory_order_acquire);
+
+        if (head == tail) {
+            int ret = syscall(__NR_io_uring_enter, r->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            if (ret < 0 && errno != EINTR)
+                return AVERROR(errno);
+            continue;
+        }
+        for (; head != tail; head++) {
+            struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+            URingBuffer *done = &r->bufs[cqe->user_data];
+            if (cqe->res < 0) {
+                done->size = AVERROR(-cqe->res);
+            } else {
+                done->size += cqe->res;
+                done->eof   = !cqe->res;
+            }
+            done->pending = 0;
+        }
+        atomic_store_explicit((_Atomic unsigned *)r->cq_head, head, memory_order_release);
+    }
+    return 0;
+}
+
+/**
+ * Wait for all the reads in flight and empty the read-ahead window.
+ */
+static int uring_drain(URing *r)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < URING_MAX_DEPTH; i++)
+        if (r->bufs[i].pending && (ret = uring_wait(r, &r->bufs[i])) < 0)
+            break;
+    r->nb_queued = 0;
+    return ret;
+}
+
+static int uring_read(URLContext *h, unsigned char *buf, int size)
+{
+    FileContext *c = h->priv_data;
+    URing *r = c->uring;
+    URingBuffer *b;
+    int64_t avail;
+    int ret;
+
+    if (!r->nb_queued) {
+        /* (re)start the read-ahead at the current position */
+        r->head        = 0;
+        r->next_offset = c->direct ? c->pos & ~(int64_t)(URING_ALIGN - 1) : c->pos;
+        for (r->nb_queued = 0; r->nb_queued < c->queue_depth; r->nb_queued++) {
+            b = &r->bufs[r->nb_queued];
+            b->offset = r->next_offset;
+            b->size   = 0;
+            b->eof    = 0;
+            r->next_offset += c->io_size;
+            uring_queue_read(r, c->fd, r->nb_queued, c->io_size);
+        }
+        if ((ret = uring_submit(r)) < 0)
+            return ret;
+    }
+
+    b = &r->bufs[r->head];
+    for (;;) {
+        if ((ret = uring_wait(r, b)) < 0)
+            return ret;
+        if (b->size < 0) {
+            ret = b->size;
+            uring_drain(r);
+            return ret;
+        }
+        avail = b->offset + b->size - c->pos;
+        /* With O_DIRECT, reads only stop at an unaligned size at the end of
+         * the file, and the rest could not be read from there anyway. */
+        if (avail > 0 || b->eof || (c->direct && b->size % URING_ALIGN))
+            break;
+        /* A read can complete short before the end of file, read the rest
+         * of the buffer. Consumed buffers are requeued right away, so the
+         * current one can not be complete. */
+        av_assert1(b->size < c->io_size);
+        uring_queue_read(r, c->fd, r->head, c->io_size);
+        if ((ret = uring_submit(r)) < 0)
+            return ret;
+    }
+
+    if (avail <= 0) {
+        if (!c->follow)
+            return AVERROR_EOF;
+        /* read again from the current position next time */
+        ret = uring_drain(r);
+        return ret < 0 ? ret : AVERROR(EAGAIN);
+    }
+    size = FFMIN(size, avail);
+    memcpy(buf, b->data + (c->pos - b->offset), size);
+    c->pos += size;
+
+    if (c->pos == b->offset + c->io_size) {
+        /* buffer consumed, reuse it for the next block */
+        b->offset       = r->next_offset;
+        b->size         = 0;
+        b->eof          = 0;
+        r->next_offset += c->io_size;
+        uring_queue_read(r, c->fd, r->head, c->io_size);
+        r->head = (r->head + 1) % c->queue_depth;
+        if ((ret = uring_submit(r)) < 0)
+            return ret;
+    }
+    return size;
+}
+
+static int uring_open(URLContext *h, const char *filename, int access)
+{
+    FileContext *c = h->priv_data;
+    struct stat st;
+    int ret;
+
+    if (fstat(c->fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        av_log(h, AV_LOG_VERBOSE, "io_uring is only used for regular files\n");
+        return 0;
+    }
+
+    ret = uring_alloc(&c->uring, c->queue_depth, c->io_size);
+    if (ret < 0) {
+        av_log(h, AV_LOG_WARNING, "io_uring not available (%s), using blocking reads\n",
+               av_err2str(ret));
+        return 0;
+    }
+    c->pos = lseek(c->fd, 0, SEEK_CUR);
+    if (c->pos < 0)
+        c->pos = 0;
+
+#ifdef O_DIRECT
+    if (c->direct) {
+        int fd = avpriv_open(filename, access | O_DIRECT, 0666);
+        if (fd >= 0) {
+            close(c->fd);
+            c->fd = fd;
+        } else {
+            av_log(h, AV_LOG_WARNING, "O_DIRECT not supported: %s\n", av_err2str(AVERROR(errno)));
+            c->direct = 0;
+        }
+    }
+#else
+    c->direct = 0;
+#endif
+    return 0;
+}
+#endif /* FILE_URING */
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if FILE_URING
+    if (c->uring)
+        return uring_read(h, buf, size);
+#endif
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -243,6 +591,19 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+    if (c->io_engine == FILE_IO_URING && !(flags & AVIO_FLAG_WRITE)) {
+#if FILE_URING
+        if (c->io_size % URING_ALIGN) {
+            av_log(h, AV_LOG_ERROR, "io_size must be a multiple of %d\n", URING_ALIGN);
+            close(fd);
+            return AVERROR(EINVAL);
+        }
+        return uring_open(h, filename, access);
+#else
+        av_log(h, AV_LOG_WARNING, "io_uring not supported in this build, using blocking reads\n");
+#endif
+    }
+
     return 0;
 }
 
@@ -258,6 +619,28 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+#if FILE_URING
+    if (c->uring) {
+        URing *r = c->uring;
+        if (whence == SEEK_CUR)
+            pos += c->pos;
+        else if (whence == SEEK_END)
+            pos += file_seek(h, 0, AVSEEK_SIZE);
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        /* keep the read-ahead window if the position stays inside it */
+        if (r->nb_queued && (pos < r->bufs[r->head].offset || pos >= r->next_offset ||
+                             pos >= r->bufs[r->head].offset + c->io_size)) {
+            ret = uring_drain(r);
+            if (ret < 0)
+                return ret;
+        }
+        return c->pos = pos;
+    }
+#endif
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -266,6 +649,12 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+#if FILE_URING
+    if (c->uring) {
+        uring_drain(c->uring);
+        uring_free(&c->uring);
+    }
+#endif
     return close(c->fd);
 }
 
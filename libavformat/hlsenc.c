@@ -51,6 +51,7 @@
 #include "http.h"
 #endif
 #include "hlsplaylist.h"
+#include "httppool.h"
 #include "internal.h"
 #include "os_support.h"
 
@@ -250,6 +251,7 @@ typedef struct HLSContext {
     char *master_pl_name;
     unsigned int master_publish_rate;
     int http_persistent;
+    HTTPPool http_pool;
     AVIOContext *m3u8_out;
     AVIOContext *sub_m3u8_out;
     int64_t timeout;
@@ -265,7 +267,9 @@ static int hlsenc_io_open(AVFormatContext *s, AVIOContext **pb, char *filename,
     HLSContext *hls = s->priv_data;
     int http_base_proto = filename ? ff_is_http_proto(filename) : 0;
     int err = AVERROR_MUXER_NOT_FOUND;
-    if (!*pb || !http_base_proto || !hls->http_persistent) {
+    if (!*pb && http_base_proto && hls->http_persistent) {
+        err = ff_http_pool_open(s, &hls->http_pool, pb, filename, options);
+    } else if (!*pb || !http_base_proto || !hls->http_persistent) {
         err = s->io_open(s, pb, filename, AVIO_FLAG_WRITE, options);
 #if CONFIG_HTTP_PROTOCOL
     } else {
@@ -289,14 +293,8 @@ static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
         return ret;
     if (!http_base_proto || !hls->http_persistent || hls->key_info_file || hls->encrypt) {
         ff_format_io_close(s, pb);
-#if CONFIG_HTTP_PROTOCOL
     } else {
-        URLContext *http_url_context = ffio_geturlcontext(*pb);
-        av_assert0(http_url_context);
-        avio_flush(*pb);
-        ffurl_shutdown(http_url_context, AVIO_FLAG_WRITE);
-        ret = ff_http_get_shutdown_status(http_url_context);
-#endif
+        ret = ff_http_pool_release(s, &hls->http_pool, pb, 1);
     }
     return ret;
 }
@@ -2664,6 +2662,7 @@ static void hls_deinit(AVFormatContext *s)
 
     ff_format_io_close(s, &hls->m3u8_out);
     ff_format_io_close(s, &hls->sub_m3u8_out);
+    ff_http_pool_close(s, &hls->http_pool);
     av_freep(&hls->key_basename);
     av_freep(&hls->var_streams);
     av_freep(&hls->cc_streams);
@@ -0,0 +1,139 @@
+/*
+ * Pool of persistent HTTP connections for segmenting muxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+
+#include "libavutil/avstring.h"
+
+#include "avio_internal.h"
+#include "http.h"
+#include "httppool.h"
+#include "internal.h"
+#include "url.h"
+
+static AVIOContext *pool_take(HTTPPool *pool, int i)
+{
+    AVIOContext *pb = pool->idle[i];
+
+    pool->nb_idle--;
+    memmove(pool->idle + i, pool->idle + i + 1, (pool->nb_idle - i) * sizeof(*pool->idle));
+    return pb;
+}
+
+/**
+ * Check that a connection opened for url1 can send a request for url2,
+ * with the same comparison as ff_http_do_new_request2().
+ */
+static int same_server(const char *url1, const char *url2)
+{
+    char proto1[10], proto2[10], host1[1024], host2[1024];
+    int port1, port2;
+
+    av_url_split(proto1, sizeof(proto1), NULL, 0, host1, sizeof(host1),
+                 &port1, NULL, 0, url1);
+    av_url_split(proto2, sizeof(proto2), NULL, 0, host2, sizeof(host2),
+                 &port2, NULL, 0, url2);
+    return !strcmp(proto1, proto2) && !strcmp(host1, host2) && port1 == port2;
+}
+
+int ff_http_pool_open(AVFormatContext *s, HTTPPool *pool, AVIOContext **pb,
+                      const char *url, AVDictionary **options)
+{
+#if CONFIG_HTTP_PROTOCOL
+    int i = 0;
+
+    while (i < pool->nb_idle) {
+        URLContext *h = ffio_geturlcontext(pool->idle[i]);
+        AVIOContext *conn;
+        AVDictionary *opts = NULL;
+        int ret;
+
+        if (!h || !same_server(h->filename, url)) {
+            i++;
+            continue;
+        }
+        conn = pool_take(pool, i);
+
+        /* The request consumes the options it applies, keep the original
+         * ones for the next attempt and for opening a new connection. */
+        ret = options ? av_dict_copy(&opts, *options, 0) : 0;
+        if (ret >= 0)
+            ret = ff_http_do_new_request2(h, url, &opts);
+
+        if (ret >= 0) {
+            if (options) {
+                av_dict_free(options);
+                *options = opts;
+            }
+            *pb = conn;
+            return 0;
+        }
+        av_dict_free(&opts);
+        av_log(s, AV_LOG_DEBUG, "Pooled HTTP connection not reusable for '%s': %s\n",
+               url, av_err2str(ret));
+        ff_format_io_close(s, &conn);
+    }
+#endif
+    return s->io_open(s, pb, url, AVIO_FLAG_WRITE, options);
+}
+
+int ff_http_pool_release(AVFormatContext *s, HTTPPool *pool, AVIOContext **pb,
+                         int wait)
+{
+#if CONFIG_HTTP_PROTOCOL
+    URLContext *h;
+    int ret = 0;
+
+    if (!*pb)
+        return 0;
+    h = ffio_geturlcontext(*pb);
+    if (!h || !h->prot || strcmp(h->prot->name, "http") && strcmp(h->prot->name, "https")) {
+        ff_format_io_close(s, pb);
+        return 0;
+    }
+    avio_flush(*pb);
+    ffurl_shutdown(h, AVIO_FLAG_WRITE);
+    if (wait) {
+        ret = ff_http_get_shutdown_status(h);
+        if (ret < 0) {
+            ff_format_io_close(s, pb);
+            return ret;
+        }
+    }
+    if (pool->nb_idle == HTTP_POOL_MAX_IDLE) {
+        AVIOContext *oldest = pool_take(pool, 0);
+        ff_format_io_close(s, &oldest);
+    }
+    pool->idle[pool->nb_idle++] = *pb;
+    *pb = NULL;
+    return ret;
+#else
+    ff_format_io_close(s, pb);
+    return 0;
+#endif
+}
+
+void ff_http_pool_close(AVFormatContext *s, HTTPPool *pool)
+{
+    while (pool->nb_idle) {
+        AVIOContext *pb = pool_take(pool, 0);
+        ff_format_io_close(s, &pb);
+    }
+}
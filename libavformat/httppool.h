@@ -0,0 +1,66 @@
+/*
+ * Pool of persistent HTTP connections for segmenting muxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_HTTPPOOL_H
+#define AVFORMAT_HTTPPOOL_H
+
+#include "avformat.h"
+#include "avio.h"
+
+#define HTTP_POOL_MAX_IDLE 8
+
+/**
+ * Idle persistent HTTP connections, shared by all the files (segments,
+ * playlists, manifests) a muxer uploads.
+ */
+typedef struct HTTPPool {
+    AVIOContext *idle[HTTP_POOL_MAX_IDLE]; ///< oldest first
+    int nb_idle;
+} HTTPPool;
+
+/**
+ * Open url for writing. If the pool holds an idle connection to the same
+ * server (scheme, host and port), a new request is started on it instead of
+ * connecting again. Connections the server has closed in the meantime are
+ * dropped.
+ */
+int ff_http_pool_open(AVFormatContext *s, HTTPPool *pool, AVIOContext **pb,
+                      const char *url, AVDictionary **options);
+
+/**
+ * Finish the request on *pb and hand the connection over to the pool.
+ * *pb is set to NULL.
+ *
+ * @param wait if nonzero, wait for the response and return its status;
+ *             connections whose request failed are closed instead.
+ *             Otherwise the response is only drained when a later request
+ *             on the connection is finished, so uploads are not serialized
+ *             on the server round trip.
+ * @return 0 or a negative error code of the finished request
+ */
+int ff_http_pool_release(AVFormatContext *s, HTTPPool *pool, AVIOContext **pb,
+                         int wait);
+
+/**
+ * Close all idle connections.
+ */
+void ff_http_pool_close(AVFormatContext *s, HTTPPool *pool);
+
+#endif /* AVFORMAT_HTTPPOOL_H */
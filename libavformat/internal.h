@@ -191,6 +191,15 @@ struct AVStreamInternal {
     int is_intra_only;
 
     FFFrac *priv_pts;
+
+    /**
+     * avformat_find_stream_info() statistics: packets read, frames decoded
+     * and time spent until the codec parameters of the stream were known.
+     */
+    int probe_params_found;
+    int probe_nb_packets;
+    int probe_nb_decoded;
+    int64_t probe_time;
 };
 
 #ifdef __GNUC__
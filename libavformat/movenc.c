@@ -4784,21 +4784,21 @@ static int mov_write_prft_tag(AVIOContext *pb, MOVMuxContext *mov, int tracks)
         return 0;
     }
 
-    if (first_track->cluster[0].pts == AV_NOPTS_VALUE) {
+    if (first_track->frag_first_pts == AV_NOPTS_VALUE) {
         av_log(mov->fc, AV_LOG_WARNING, "Unable to write PRFT, first PTS is invalid\n");
         return 0;
     }
 
     if (mov->write_prft == MOV_PRFT_SRC_WALLCLOCK) {
-        if (first_track->cluster[0].prft.wallclock) {
+        if (first_track->frag_prft.wallclock) {
             /* Round the NTP time to whole milliseconds. */
-            ntp_ts = ff_get_formatted_ntp_time((first_track->cluster[0].prft.wallclock / 1000) * 1000 +
+            ntp_ts = ff_get_formatted_ntp_time((first_track->frag_prft.wallclock / 1000) * 1000 +
                                                NTP_OFFSET_US);
-            flags = first_track->cluster[0].prft.flags;
+            flags = first_track->frag_prft.flags;
         } else
             ntp_ts = ff_get_formatted_ntp_time(ff_ntp_time());
     } else if (mov->write_prft == MOV_PRFT_SRC_PTS) {
-        pts_us = av_rescale_q(first_track->cluster[0].pts,
+        pts_us = av_rescale_q(first_track->frag_first_pts,
                               first_track->st->time_base, AV_TIME_BASE_Q);
         ntp_ts = ff_get_formatted_ntp_time(pts_us + NTP_OFFSET_US);
     } else {
@@ -4813,7 +4813,7 @@ static int mov_write_prft_tag(AVIOContext *pb, MOVMuxContext *mov, int tracks)
     avio_wb24(pb, flags);                       // Flags
     avio_wb32(pb, first_track->track_id);       // reference track ID
     avio_wb64(pb, ntp_ts);                      // NTP time stamp
-    avio_wb64(pb, first_track->cluster[0].pts); //media time
+    avio_wb64(pb, first_track->frag_first_pts); //media time
     return update_size(pb, pos);
 }
 
@@ -5724,7 +5724,8 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     trk->cluster[trk->entry].size             = size;
     trk->cluster[trk->entry].entries          = samples_in_chunk;
     trk->cluster[trk->entry].dts              = pkt->dts;
-    trk->cluster[trk->entry].pts              = pkt->pts;
+    if (!trk->entry)
+        trk->frag_first_pts = pkt->pts;
     if (!trk->entry && trk->start_dts != AV_NOPTS_VALUE) {
         if (!trk->frag_discont) {
             /* First packet of a new fragment. We already wrote the duration
@@ -5825,11 +5826,13 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
         trk->has_disposable++;
     }
 
-    prft = (AVProducerReferenceTime *)av_packet_get_side_data(pkt, AV_PKT_DATA_PRFT, &prft_size);
-    if (prft && prft_size == sizeof(AVProducerReferenceTime))
-        memcpy(&trk->cluster[trk->entry].prft, prft, prft_size);
-    else
-        memset(&trk->cluster[trk->entry].prft, 0, sizeof(AVProducerReferenceTime));
+    if (!trk->entry) {
+        prft = (AVProducerReferenceTime *)av_packet_get_side_data(pkt, AV_PKT_DATA_PRFT, &prft_size);
+        if (prft && prft_size == sizeof(AVProducerReferenceTime))
+            memcpy(&trk->frag_prft, prft, prft_size);
+        else
+            memset(&trk->frag_prft, 0, sizeof(AVProducerReferenceTime));
+    }
 
     trk->entry++;
     trk->sample_count += samples_in_chunk;
@@ -6407,7 +6410,14 @@ static int mov_init(AVFormatContext *s)
         mov->flags &= ~FF_MOV_FLAG_SKIP_SIDX;
     }
 
-    if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+    if (mov->reserved_moov_size > 0 && mov->reserved_moov_size < 8) {
+        av_log(s, AV_LOG_ERROR, "moov_size must be at least 8 bytes\n");
+        return AVERROR(EINVAL);
+    }
+
+    /* With a reserved moov space, faststart only needs a second pass if the
+     * moov turns out not to fit. */
+    if (mov->flags & FF_MOV_FLAG_FASTSTART && !mov->reserved_moov_size) {
         mov->reserved_moov_size = -1;
     }
 
@@ -6757,8 +6767,12 @@ static int mov_write_header(AVFormatContext *s)
 
     if (mov->reserved_moov_size){
         mov->reserved_header_pos = avio_tell(pb);
-        if (mov->reserved_moov_size > 0)
-            avio_skip(pb, mov->reserved_moov_size);
+        if (mov->reserved_moov_size > 0) {
+            /* Keep the file valid if the space is shifted by faststart */
+            avio_wb32(pb, mov->reserved_moov_size);
+            ffio_wfourcc(pb, "free");
+            ffio_fill(pb, 0, mov->reserved_moov_size - 8);
+        }
     }
 
     if (mov->flags & FF_MOV_FLAG_FRAGMENT) {
@@ -6769,7 +6783,7 @@ static int mov_write_header(AVFormatContext *s)
             !mov->max_fragment_duration && !mov->max_fragment_size)
             mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
     } else {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size < 0)
             mov->reserved_header_pos = avio_tell(pb);
         mov_write_mdat_tag(pb, mov);
     }
@@ -7033,7 +7047,20 @@ static int mov_write_trailer(AVFormatContext *s)
         }
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_header_pos : moov_pos, SEEK_SET);
 
-        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size > 0) {
+            int moov_size = get_moov_size(s);
+            if (moov_size < 0)
+                return moov_size;
+            if (moov_size != mov->reserved_moov_size &&
+                moov_size > mov->reserved_moov_size - 8) {
+                av_log(s, AV_LOG_INFO, "moov atom of %d bytes does not fit in the "
+                       "reserved moov_size, falling back to a second pass\n", moov_size);
+                avio_seek(pb, moov_pos, SEEK_SET);
+                mov->reserved_moov_size = -1;
+            }
+        }
+
+        if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->reserved_moov_size < 0) {
             av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
             res = shift_data(s);
             if (res < 0)
@@ -7046,6 +7073,10 @@ static int mov_write_trailer(AVFormatContext *s)
             if ((res = mov_write_moov_tag(pb, mov, s)) < 0)
                 return res;
             size = mov->reserved_moov_size - (avio_tell(pb) - mov->reserved_header_pos);
+            if (!size) {
+                avio_seek(pb, moov_pos, SEEK_SET);
+                return 0;
+            }
             if (size < 8){
                 av_log(s, AV_LOG_ERROR, "reserved_moov_size is too small, needed %"PRId64" additional\n", 8-size);
                 return AVERROR(EINVAL);
@@ -46,7 +46,6 @@
 typedef struct MOVIentry {
     uint64_t     pos;
     int64_t      dts;
-    int64_t      pts;
     unsigned int size;
     unsigned int samples_in_chunk;
     unsigned int chunkNum;              ///< Chunk number if the current entry is a chunk start otherwise 0
@@ -56,7 +55,6 @@ typedef struct MOVIentry {
 #define MOV_PARTIAL_SYNC_SAMPLE 0x0002
 #define MOV_DISPOSABLE_SAMPLE   0x0004
     uint32_t     flags;
-    AVProducerReferenceTime prft;
 } MOVIentry;
 
 typedef struct HintSample {
@@ -139,6 +137,8 @@ typedef struct MOVTrack {
     AVIOContext *mdat_buf;
     int64_t     data_offset;
     int64_t     frag_start;
+    int64_t     frag_first_pts;     ///< pts of cluster[0], used for prft
+    AVProducerReferenceTime frag_prft; ///< producer reference time of cluster[0]
     int         frag_discont;
     int         entries_flushed;
 
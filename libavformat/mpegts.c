@@ -38,6 +38,7 @@
 #include "avio_internal.h"
 #include "mpeg.h"
 #include "isom.h"
+#include "seekindex.h"
 #if CONFIG_ICONV
 #include <iconv.h>
 #endif
@@ -154,6 +155,12 @@ struct MpegTSContext {
     int resync_size;
     int merge_pmt_versions;
 
+    /** build a keyframe index on the first seek */
+    int seek_index;
+    char *seek_index_file;
+    /** 0 not built yet, 1 ready, -1 unavailable */
+    int seek_index_state;
+
     /******************************************/
     /* private mpegts data */
     /* scan context */
@@ -166,6 +173,12 @@ struct MpegTSContext {
     MpegTSFilter *pids[NB_PID_MAX];
     int current_pid;
 
+    /** cache of discard_pid(): pids whose state is known, and the discarded ones */
+    uint32_t discard_known[NB_PID_MAX / 32];
+    uint32_t discard_map[NB_PID_MAX / 32];
+    /** programs and their discard state the cache was computed for */
+    uint64_t discard_signature;
+
     AVStream *epg_stream;
     AVBufferPool* pools[32];
 };
@@ -189,6 +202,10 @@ static const AVOption options[] = {
      {.i64 = 0}, 0, 1, 0 },
     {"skip_clear", "skip clearing programs", offsetof(MpegTSContext, skip_clear), AV_OPT_TYPE_BOOL,
      {.i64 = 0}, 0, 1, 0 },
+    {"seek_index", "build a keyframe index on the first seek", offsetof(MpegTSContext, seek_index), AV_OPT_TYPE_BOOL,
+     {.i64 = 0}, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    {"seek_index_file", "load the keyframe index from or save it to this file", offsetof(MpegTSContext, seek_index_file), AV_OPT_TYPE_STRING,
+     {.str = NULL}, 0, 0, AV_OPT_FLAG_DECODING_PARAM },
     { NULL },
 };
 
@@ -285,10 +302,17 @@ static void clear_avprogram(MpegTSContext *ts, unsigned int programid)
     prg->nb_stream_indexes = 0;
 }
 
+static void invalidate_discard_map(MpegTSContext *ts)
+{
+    memset(ts->discard_known, 0, sizeof(ts->discard_known));
+    memset(ts->discard_map,   0, sizeof(ts->discard_map));
+}
+
 static void clear_program(MpegTSContext *ts, unsigned int programid)
 {
     int i;
 
+    invalidate_discard_map(ts);
     clear_avprogram(ts, programid);
     for (i = 0; i < ts->nb_prg; i++)
         if (ts->prg[i].id == programid) {
@@ -299,6 +323,7 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
 
 static void clear_programs(MpegTSContext *ts)
 {
+    invalidate_discard_map(ts);
     av_freep(&ts->prg);
     ts->nb_prg = 0;
 }
@@ -315,6 +340,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->nb_pids = 0;
     p->pmt_found = 0;
     ts->nb_prg++;
+    invalidate_discard_map(ts);
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
@@ -333,6 +359,7 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid,
             return;
 
     p->pids[p->nb_pids++] = pid;
+    invalidate_discard_map(ts);
 }
 
 static void set_pmt_found(MpegTSContext *ts, unsigned int programid)
@@ -374,7 +401,7 @@ static void update_av_program_info(AVFormatContext *s, unsigned int programid,
  * @return 1 if the pid is only comprised in programs that have .discard=AVDISCARD_ALL
  *         0 otherwise
  */
-static int discard_pid(MpegTSContext *ts, unsigned int pid)
+static int discard_pid_uncached(MpegTSContext *ts, unsigned int pid)
 {
     int i, j, k;
     int used = 0, discarded = 0;
@@ -408,6 +435,52 @@ static int discard_pid(MpegTSContext *ts, unsigned int pid)
     return !used && discarded;
 }
 
+/**
+ * Drop the discard_pid() cache if the programs or their discard flags
+ * changed since it was filled. The PMT side is handled by the functions
+ * which update ts->prg.
+ */
+static void check_discard_map(MpegTSContext *ts)
+{
+    uint64_t signature = ts->stream->nb_programs;
+    int k;
+
+    for (k = 0; k < ts->stream->nb_programs; k++) {
+        const AVProgram *program = ts->stream->programs[k];
+        signature = signature * 0x100000001B3ULL +
+                    ((uint64_t)program->id << 1 | (program->discard == AVDISCARD_ALL));
+    }
+    if (signature != ts->discard_signature) {
+        ts->discard_signature = signature;
+        invalidate_discard_map(ts);
+    }
+}
+
+static int discard_pid(MpegTSContext *ts, unsigned int pid)
+{
+    uint32_t bit = 1U << (pid & 31);
+
+    if (!(ts->discard_known[pid >> 5] & bit)) {
+        ts->discard_known[pid >> 5] |= bit;
+        if (discard_pid_uncached(ts, pid))
+            ts->discard_map[pid >> 5] |= bit;
+    }
+    return !!(ts->discard_map[pid >> 5] & bit);
+}
+
+/**
+ * @return 1 if handle_packet() would ignore a packet starting at p,
+ *         because its pid is unknown or discarded
+ */
+static av_always_inline int skip_pid(MpegTSContext *ts, const uint8_t *p)
+{
+    unsigned pid = AV_RB16(p + 1) & 0x1fff;
+
+    if (!ts->pids[pid])
+        return !ts->auto_guess;
+    return ts->discard_map[pid >> 5] >> (pid & 31) & 1;
+}
+
 /**
  *  Assemble PES packets out of TS packets, and then call the "section_cb"
  *  function when they are complete.
@@ -582,16 +655,19 @@ static int analyze(const uint8_t *buf, int size, int packet_size,
     memset(stat, 0, packet_size * sizeof(*stat));
 
     for (i = 0; i < size - 3; i++) {
-        if (buf[i] == 0x47) {
-            int pid = AV_RB16(buf+1) & 0x1FFF;
-            int asc = buf[i + 3] & 0x30;
-            if (!probe || pid == 0x1FFF || asc) {
-                int x = i % packet_size;
-                stat[x]++;
-                stat_all++;
-                if (stat[x] > best_score) {
-                    best_score = stat[x];
-                }
+        const uint8_t *sync = memchr(buf + i, 0x47, size - 3 - i);
+        int pid, asc;
+        if (!sync)
+            break;
+        i   = sync - buf;
+        pid = AV_RB16(buf+1) & 0x1FFF;
+        asc = buf[i + 3] & 0x30;
+        if (!probe || pid == 0x1FFF || asc) {
+            int x = i % packet_size;
+            stat[x]++;
+            stat_all++;
+            if (stat[x] > best_score) {
+                best_score = stat[x];
             }
         }
     }
@@ -2856,12 +2932,27 @@ static int mpegts_resync(AVFormatContext *s, int seekback, const uint8_t *curren
     avio_seek(pb, -back, SEEK_CUR);
 
     for (i = 0; i < ts->resync_size; i++) {
-        c = avio_r8(pb);
-        if (avio_feof(pb))
-            return AVERROR_EOF;
+        /* scan the buffered data with memchr(), refill byte by byte */
+        int buffered = FFMIN(pb->buf_end - pb->buf_ptr, ts->resync_size - i);
+        if (buffered > 0) {
+            const uint8_t *sync = memchr(pb->buf_ptr, 0x47, buffered);
+            int skip = sync ? sync - pb->buf_ptr : buffered;
+            avio_skip(pb, skip);
+            if (!sync) {
+                i += buffered - 1;
+                continue;
+            }
+            i += skip;
+            c = 0x47;
+        } else {
+            c = avio_r8(pb);
+            if (avio_feof(pb))
+                return AVERROR_EOF;
+            if (c == 0x47)
+                avio_seek(pb, -1, SEEK_CUR);
+        }
         if (c == 0x47) {
             int new_packet_size, ret;
-            avio_seek(pb, -1, SEEK_CUR);
             pos = avio_tell(pb);
             ret = ffio_ensure_seekback(pb, PROBE_PACKET_MAX_BUF);
             if (ret < 0)
@@ -2943,6 +3034,8 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         }
     }
 
+    check_discard_map(ts);
+
     ts->stop_parse = 0;
     packet_num = 0;
     memset(packet + TS_PACKET_SIZE, 0, AV_INPUT_BUFFER_PADDING_SIZE);
@@ -2956,6 +3049,25 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        /* Skip the packets of unwanted pids directly in the I/O buffer,
+         * which matters when a single service is taken from a large
+         * multiplex. Anything else goes through read_packet(). */
+        if (s->pb->buf_end - s->pb->buf_ptr >= ts->raw_packet_size) {
+            const uint8_t *p = s->pb->buf_ptr, *end = s->pb->buf_end - ts->raw_packet_size;
+            int64_t max_skip = nb_packets ? nb_packets - packet_num : INT64_MAX;
+            int skip = 0;
+
+            while (p <= end && skip < max_skip && p[0] == 0x47 && skip_pid(ts, p)) {
+                p += ts->raw_packet_size;
+                skip++;
+            }
+            if (skip) {
+                avio_skip(s->pb, p - s->pb->buf_ptr);
+                packet_num += skip - 1;
+                continue;
+            }
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
@@ -3250,6 +3362,102 @@ static int mpegts_read_close(AVFormatContext *s)
     return 0;
 }
 
+static int seek_index_add_pes(AVFormatContext *s, PESContext *pes,
+                              const uint8_t *packet, int64_t pos)
+{
+    AVStream *st = pes->st;
+    const uint8_t *p = packet + 4, *p_end = packet + TS_PACKET_SIZE;
+    int afc = (packet[3] >> 4) & 3, key = 0, flags, ret;
+    int64_t dts;
+
+    if (!(afc & 1))
+        return 0;
+    if (afc & 2) {
+        key = p[0] && (p[1] & 0x40); /* random_access_indicator */
+        p += p[0] + 1;
+    }
+    if (p_end - p < 14 || AV_RB24(p) != 1)
+        return 0;
+    /* stream ids without the optional PES header */
+    if (p[3] == 0xbc || p[3] == 0xbe || p[3] == 0xbf ||
+        p[3] == 0xf0 || p[3] == 0xf1 || p[3] == 0xf2 || p[3] == 0xf8 || p[3] == 0xff)
+        return 0;
+    flags = p[7];
+    if (!(flags & 0x80))
+        return 0;
+    if (flags & 0x40) {
+        if (p_end - p < 19)
+            return 0;
+        dts = ff_parse_pes_pts(p + 14);
+    } else {
+        dts = ff_parse_pes_pts(p + 9);
+    }
+
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        p += 9 + p[8];
+        if (!key && p < p_end)
+            key = ff_seek_index_is_keyframe(st->codecpar->codec_id, p, p_end - p) > 0;
+    } else {
+        key = 1;
+    }
+    if (!key)
+        return 0;
+
+    ret = av_add_index_entry(st, pos, dts, 0, 0, AVINDEX_KEYFRAME);
+    if (ret < 0)
+        return ret;
+    if (ret != st->nb_index_entries - 1) {
+        av_log(s, AV_LOG_WARNING, "Timestamp discontinuity in stream %d at %"PRId64", "
+               "cannot index\n", st->index, pos);
+        return AVERROR_PATCHWELCOME;
+    }
+    return 0;
+}
+
+/* index the keyframes of all the streams known so far */
+static int mpegts_build_seek_index(AVFormatContext *s)
+{
+    MpegTSContext *ts = s->priv_data;
+    uint8_t packet[TS_PACKET_SIZE + AV_INPUT_BUFFER_PADDING_SIZE];
+    const uint8_t *data;
+    int ret;
+
+    for (;;) {
+        MpegTSFilter *tss;
+        int64_t pos;
+
+        ret = read_packet(s, packet, ts->raw_packet_size, &data);
+        if (ret == AVERROR(EAGAIN))
+            continue;
+        if (ret < 0)
+            break;
+        pos = avio_tell(s->pb) - ts->raw_packet_size;
+        tss = ts->pids[AV_RB16(data + 1) & 0x1fff];
+        if ((data[1] & 0x40) && tss && tss->type == MPEGTS_PES) {
+            PESContext *pes = tss->u.pes_filter.opaque;
+            if (pes->st && (ret = seek_index_add_pes(s, pes, data, pos)) < 0)
+                return ret;
+        }
+        finished_reading_packet(s, ts->raw_packet_size);
+    }
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+static int mpegts_read_seek(AVFormatContext *s, int stream_index,
+                            int64_t timestamp, int flags)
+{
+    MpegTSContext *ts = s->priv_data;
+
+    if (!ts->seek_index && !ts->seek_index_file || ts->seek_index_state < 0)
+        return -1;
+    if (!ts->seek_index_state)
+        ts->seek_index_state = ff_seek_index_init(s, ts->seek_index_file,
+                                                  mpegts_build_seek_index) < 0 ? -1 : 1;
+    if (ts->seek_index_state < 0)
+        return -1;
+    return ff_seek_index_seek(s, stream_index, timestamp, flags);
+}
+
 static av_unused int64_t mpegts_get_pcr(AVFormatContext *s, int stream_index,
                               int64_t *ppos, int64_t pos_limit)
 {
@@ -3381,6 +3589,7 @@ AVInputFormat ff_mpegts_demuxer = {
     .read_header    = mpegts_read_header,
     .read_packet    = mpegts_read_packet,
     .read_close     = mpegts_read_close,
+    .read_seek      = mpegts_read_seek,
     .read_timestamp = mpegts_get_dts,
     .flags          = AVFMT_SHOW_IDS | AVFMT_TS_DISCONT,
     .priv_class     = &mpegts_class,
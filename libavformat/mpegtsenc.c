@@ -26,6 +26,7 @@
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
+#include "libavutil/time.h"
 
 #include "libavcodec/ac3_parser_internal.h"
 #include "libavcodec/internal.h"
@@ -113,6 +114,14 @@ typedef struct MpegTSWrite {
     int64_t last_sdt_ts;
 
     int omit_video_pes_length;
+
+    int packets_per_write;
+    uint8_t *write_buf;     ///< TS packets waiting to be written as one chunk
+    int write_buf_size;
+    int write_buf_pos;
+    int pacing;
+    int64_t pacing_burst;   ///< max catch up burst in microseconds
+    int64_t pacing_start;   ///< wall clock time of PCR 0 of the output
 } MpegTSWrite;
 
 /* a PES packet header is generated every DEFAULT_PES_HEADER_FREQ packets */
@@ -830,12 +839,64 @@ invalid:
     return 0;
 }
 
+/* output position, including packets not handed to the AVIOContext yet */
+static int64_t mpegts_tell(const MpegTSWrite *ts, AVIOContext *pb)
+{
+    return avio_tell(pb) + ts->write_buf_pos;
+}
+
 static int64_t get_pcr(const MpegTSWrite *ts, AVIOContext *pb)
 {
-    return av_rescale(avio_tell(pb) + 11, 8 * PCR_TIME_BASE, ts->mux_rate) +
+    return av_rescale(mpegts_tell(ts, pb) + 11, 8 * PCR_TIME_BASE, ts->mux_rate) +
            ts->first_pcr;
 }
 
+/* Hold the output back until the wall clock catches up with the PCR of the
+ * data about to be written. Falling behind by more than pacing_burst drops
+ * the excess, so at most pacing_burst worth of data is sent back to back. */
+static void pace_output(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    int64_t now = av_gettime_relative();
+    int64_t target;
+
+    if (ts->pacing_start == AV_NOPTS_VALUE)
+        ts->pacing_start = now;
+    target = ts->pacing_start +
+             av_rescale(avio_tell(s->pb), 8 * AV_TIME_BASE, ts->mux_rate);
+    if (now < target)
+        av_usleep(target - now);
+    else if (now - target > ts->pacing_burst)
+        ts->pacing_start += now - target - ts->pacing_burst;
+}
+
+static void flush_write_buf(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    if (!ts->write_buf_pos)
+        return;
+    if (ts->pacing)
+        pace_output(s);
+    avio_write(s->pb, ts->write_buf, ts->write_buf_pos);
+    ts->write_buf_pos = 0;
+    avio_flush(s->pb);
+}
+
+static void write_data(AVFormatContext *s, const uint8_t *data, int size)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    if (!ts->write_buf) {
+        avio_write(s->pb, data, size);
+        return;
+    }
+    memcpy(ts->write_buf + ts->write_buf_pos, data, size);
+    ts->write_buf_pos += size;
+    if (ts->write_buf_pos == ts->write_buf_size)
+        flush_write_buf(s);
+}
+
 static void write_packet(AVFormatContext *s, const uint8_t *packet)
 {
     MpegTSWrite *ts = s->priv_data;
@@ -843,10 +904,10 @@ static void write_packet(AVFormatContext *s, const uint8_t *packet)
         int64_t pcr = get_pcr(s->priv_data, s->pb);
         uint32_t tp_extra_header = pcr % 0x3fffffff;
         tp_extra_header = AV_RB32(&tp_extra_header);
-        avio_write(s->pb, (unsigned char *) &tp_extra_header,
+        write_data(s, (unsigned char *) &tp_extra_header,
                    sizeof(tp_extra_header));
     }
-    avio_write(s->pb, packet, TS_PACKET_SIZE);
+    write_data(s, packet, TS_PACKET_SIZE);
 }
 
 static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
@@ -1130,6 +1191,21 @@ static int mpegts_init(AVFormatContext *s)
         }
     }
 
+    if (ts->pacing && ts->mux_rate <= 1) {
+        av_log(s, AV_LOG_ERROR, "Real time pacing requires a constant muxrate\n");
+        return AVERROR(EINVAL);
+    }
+    if (ts->pacing && !ts->packets_per_write)
+        ts->packets_per_write = 7;
+    if (ts->packets_per_write) {
+        ts->write_buf_size = ts->packets_per_write *
+                             (TS_PACKET_SIZE + (ts->m2ts_mode ? 4 : 0));
+        ts->write_buf = av_malloc(ts->write_buf_size);
+        if (!ts->write_buf)
+            return AVERROR(ENOMEM);
+    }
+    ts->pacing_start = AV_NOPTS_VALUE;
+
     if (ts->copyts < 1)
         ts->first_pcr = av_rescale(s->max_delay, PCR_TIME_BASE, AV_TIME_BASE);
 
@@ -1983,10 +2059,12 @@ static void mpegts_write_flush(AVFormatContext *s)
     }
 
     if (ts->m2ts_mode) {
-        int packets = (avio_tell(s->pb) / (TS_PACKET_SIZE + 4)) % 32;
+        int packets = (mpegts_tell(ts, s->pb) / (TS_PACKET_SIZE + 4)) % 32;
         while (packets++ < 32)
             mpegts_insert_null_packet(s);
     }
+
+    flush_write_buf(s);
 }
 
 static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
@@ -2031,6 +2109,7 @@ static void mpegts_deinit(AVFormatContext *s)
         av_freep(&service);
     }
     av_freep(&ts->services);
+    av_freep(&ts->write_buf);
 }
 
 static int mpegts_check_bitstream(struct AVFormatContext *s, const AVPacket *pkt)
@@ -2111,6 +2190,12 @@ static const AVOption options[] = {
       OFFSET(pat_period_us), AV_OPT_TYPE_DURATION, { .i64 = PAT_RETRANS_TIME * 1000LL }, 0, INT64_MAX, ENC },
     { "sdt_period", "SDT retransmission time limit in seconds",
       OFFSET(sdt_period_us), AV_OPT_TYPE_DURATION, { .i64 = SDT_RETRANS_TIME * 1000LL }, 0, INT64_MAX, ENC },
+    { "packets_per_write", "Number of TS packets written to the output at once",
+      OFFSET(packets_per_write), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 512, ENC },
+    { "pacing", "Pace the output in real time against the PCR",
+      OFFSET(pacing), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, ENC },
+    { "pacing_burst", "Maximum burst allowed to catch up when pacing, in seconds",
+      OFFSET(pacing_burst), AV_OPT_TYPE_DURATION, { .i64 = 5000 }, 0, INT64_MAX, ENC },
     { NULL },
 };
 
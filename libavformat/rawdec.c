@@ -24,6 +24,7 @@
 #include "internal.h"
 #include "avio_internal.h"
 #include "rawdec.h"
+#include "seekindex.h"
 #include "libavutil/opt.h"
 #include "libavutil/parseutils.h"
 #include "libavutil/pixdesc.h"
@@ -92,6 +93,34 @@ fail:
     return ret;
 }
 
+static int raw_video_build_seek_index(AVFormatContext *s)
+{
+    AVStream *st = s->streams[0];
+    AVRational rate = av_guess_frame_rate(s, st, NULL);
+
+    if (rate.num <= 0 || rate.den <= 0)
+        return AVERROR(EINVAL);
+
+    /* timestamps of raw streams are derived from the frame rate */
+    return ff_seek_index_build_es(s, st, st->first_dts != AV_NOPTS_VALUE ? st->first_dts : 0,
+                                  av_rescale_q(1, av_inv_q(rate), st->time_base));
+}
+
+int ff_raw_video_read_seek(AVFormatContext *s, int stream_index,
+                           int64_t timestamp, int flags)
+{
+    FFRawVideoDemuxerContext *s1 = s->priv_data;
+
+    if (!s1->seek_index && !s1->seek_index_file || s1->seek_index_state < 0)
+        return -1;
+    if (!s1->seek_index_state)
+        s1->seek_index_state = ff_seek_index_init(s, s1->seek_index_file,
+                                                  raw_video_build_seek_index) < 0 ? -1 : 1;
+    if (s1->seek_index_state < 0)
+        return -1;
+    return ff_seek_index_seek(s, stream_index, timestamp, flags);
+}
+
 int ff_raw_subtitle_read_header(AVFormatContext *s)
 {
     AVStream *st = avformat_new_stream(s, NULL);
@@ -121,6 +150,8 @@ int ff_raw_data_read_header(AVFormatContext *s)
 const AVOption ff_rawvideo_options[] = {
     { "framerate", "", OFFSET(framerate), AV_OPT_TYPE_VIDEO_RATE, {.str = "25"}, 0, INT_MAX, DEC},
     { "raw_packet_size", "", OFFSET(raw_packet_size), AV_OPT_TYPE_INT, {.i64 = RAW_PACKET_SIZE }, 1, INT_MAX, DEC},
+    { "seek_index", "build a keyframe index on the first seek", OFFSET(seek_index), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, DEC},
+    { "seek_index_file", "load the keyframe index from or save it to this file", OFFSET(seek_index_file), AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, DEC},
     { NULL },
 };
 #undef OFFSET
@@ -32,6 +32,9 @@ typedef struct FFRawVideoDemuxerContext {
     char *video_size;         /**< String describing video size, set by a private option. */
     char *pixel_format;       /**< Set by a private option. */
     AVRational framerate;     /**< AVRational describing framerate, set by a private option. */
+    int seek_index;           /**< Build a keyframe index on the first seek, set by a private option. */
+    char *seek_index_file;    /**< Where to cache the keyframe index, set by a private option. */
+    int seek_index_state;     /**< 0 not built yet, 1 ready, -1 unavailable */
 } FFRawVideoDemuxerContext;
 
 typedef struct FFRawDemuxerContext {
@@ -48,6 +51,9 @@ int ff_raw_audio_read_header(AVFormatContext *s);
 
 int ff_raw_video_read_header(AVFormatContext *s);
 
+int ff_raw_video_read_seek(AVFormatContext *s, int stream_index,
+                           int64_t timestamp, int flags);
+
 int ff_raw_subtitle_read_header(AVFormatContext *s);
 
 int ff_raw_data_read_header(AVFormatContext *s);
@@ -76,6 +82,7 @@ AVInputFormat ff_ ## shortname ## _demuxer = {\
     .read_probe     = probe,\
     .read_header    = ff_raw_video_read_header,\
     .read_packet    = ff_raw_read_partial_packet,\
+    .read_seek      = ff_raw_video_read_seek,\
     .extensions     = ext,\
     .flags          = flag,\
     .raw_codec_id   = id,\
@@ -0,0 +1,622 @@
+/*
+ * Precomputed keyframe index for seeking in files without one
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include "libavutil/crc.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavcodec/get_bits.h"
+#include "libavcodec/golomb.h"
+#include "avc.h"
+#include "avio_internal.h"
+#include "internal.h"
+#include "os_support.h"
+#include "seekindex.h"
+#include "url.h"
+
+/*
+ * Index file layout, all numbers big-endian:
+ *   'FFSI', version, size of the input, modification time of the input
+ *   in seconds or 0 if unknown (64 bits each), CRC-32 of its first and
+ *   last SEEK_INDEX_CRC_SIZE bytes, number of streams,
+ *   then for each stream: id, time base numerator and denominator,
+ *   number of entries, and for each entry its position and timestamp
+ *   (64 bits each).
+ */
+#define SEEK_INDEX_TAG      MKBETAG('F','F','S','I')
+#define SEEK_INDEX_VERSION  2
+#define SEEK_INDEX_CRC_SIZE 65536
+
+#define ES_SCAN_SIZE  65536
+#define ES_LOOKAHEAD  1024  /* start code and the headers parsed after it */
+#define ES_SLICE_HEADER_SIZE 32
+
+typedef struct SeekIndexKey {
+    int64_t  size;
+    int64_t  mtime;
+    uint32_t crc;
+} SeekIndexKey;
+
+enum ESUnit {
+    ES_OTHER,
+    ES_AU_START,        /* may only appear before the first slice of a picture */
+    ES_PICTURE,         /* first slice or picture header of a picture */
+    ES_SLICE,
+};
+
+static void seek_index_reset(AVFormatContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        av_freep(&st->index_entries);
+        st->nb_index_entries = 0;
+        st->index_entries_allocated_size = 0;
+    }
+}
+
+/* identify the input by its size, modification time and both ends */
+static int seek_index_key(AVFormatContext *s, SeekIndexKey *key)
+{
+    const AVCRC *crc_table = av_crc_get_table(AV_CRC_32_IEEE);
+    URLContext *h = ffio_geturlcontext(s->pb);
+    int64_t pos = avio_tell(s->pb), ret = 0;
+    struct stat st;
+    uint8_t *buf;
+    int fd, i;
+
+    key->size  = avio_size(s->pb);
+    key->mtime = 0;
+    key->crc   = 0;
+    if (key->size < 0)
+        return key->size;
+    fd = h ? ffurl_get_file_handle(h) : -1;
+    if (fd >= 0 && !fstat(fd, &st))
+        key->mtime = st.st_mtime;
+
+    buf = av_malloc(SEEK_INDEX_CRC_SIZE);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < 2 && key->size > 0; i++) {
+        int64_t offset = i ? FFMAX(key->size - SEEK_INDEX_CRC_SIZE, 0) : 0;
+        if ((ret = avio_seek(s->pb, offset, SEEK_SET)) < 0 ||
+            (ret = avio_read(s->pb, buf, SEEK_INDEX_CRC_SIZE)) < 0)
+            break;
+        key->crc = av_crc(crc_table, key->crc, buf, ret);
+    }
+    av_free(buf);
+    if (ret >= 0)
+        ret = avio_seek(s->pb, pos, SEEK_SET);
+    return ret < 0 ? ret : 0;
+}
+
+static int seek_index_load(AVFormatContext *s, const char *url,
+                           const SeekIndexKey *key)
+{
+    AVIOContext *pb = NULL;
+    unsigned nb_streams, nb_entries, i, j;
+    int ret;
+
+    if (s->io_open(s, &pb, url, AVIO_FLAG_READ, NULL) < 0)
+        return 0;
+
+    if (avio_rb32(pb) != SEEK_INDEX_TAG || avio_rb32(pb) != SEEK_INDEX_VERSION ||
+        avio_rb64(pb) != key->size || avio_rb64(pb) != key->mtime ||
+        avio_rb32(pb) != key->crc) {
+        av_log(s, AV_LOG_VERBOSE, "Seek index '%s' was written for another input\n", url);
+        ret = 0;
+        goto end;
+    }
+
+    seek_index_reset(s);
+    nb_streams = avio_rb32(pb);
+    for (i = 0; i < nb_streams && !avio_feof(pb); i++) {
+        AVStream *st = NULL;
+        int id = avio_rb32(pb);
+        AVRational time_base;
+
+        time_base.num = avio_rb32(pb);
+        time_base.den = avio_rb32(pb);
+        nb_entries    = avio_rb32(pb);
+        for (j = 0; j < s->nb_streams; j++) {
+            if (s->streams[j]->id == id &&
+                !av_cmp_q(s->streams[j]->time_base, time_base)) {
+                st = s->streams[j];
+                break;
+            }
+        }
+        for (j = 0; j < nb_entries && !avio_feof(pb); j++) {
+            int64_t pos       = avio_rb64(pb);
+            int64_t timestamp = avio_rb64(pb);
+            if (st && (ret = av_add_index_entry(st, pos, timestamp, 0, 0, AVINDEX_KEYFRAME)) < 0)
+                goto end;
+        }
+    }
+    if (avio_feof(pb)) {
+        av_log(s, AV_LOG_WARNING, "Seek index '%s' is truncated\n", url);
+        seek_index_reset(s);
+        ret = 0;
+        goto end;
+    }
+    ret = 1;
+
+end:
+    ff_format_io_close(s, &pb);
+    return ret;
+}
+
+static int seek_index_save(AVFormatContext *s, const char *url,
+                           const SeekIndexKey *key)
+{
+    AVIOContext *pb = NULL;
+    int ret, i, j;
+
+    if ((ret = s->io_open(s, &pb, url, AVIO_FLAG_WRITE, NULL)) < 0)
+        return ret;
+
+    avio_wb32(pb, SEEK_INDEX_TAG);
+    avio_wb32(pb, SEEK_INDEX_VERSION);
+    avio_wb64(pb, key->size);
+    avio_wb64(pb, key->mtime);
+    avio_wb32(pb, key->crc);
+    avio_wb32(pb, s->nb_streams);
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        int nb_entries = 0;
+
+        for (j = 0; j < st->nb_index_entries; j++)
+            nb_entries += !!(st->index_entries[j].flags & AVINDEX_KEYFRAME);
+        avio_wb32(pb, st->id);
+        avio_wb32(pb, st->time_base.num);
+        avio_wb32(pb, st->time_base.den);
+        avio_wb32(pb, nb_entries);
+        for (j = 0; j < st->nb_index_entries; j++) {
+            const AVIndexEntry *ie = &st->index_entries[j];
+            if (!(ie->flags & AVINDEX_KEYFRAME))
+                continue;
+            avio_wb64(pb, ie->pos);
+            avio_wb64(pb, ie->timestamp);
+        }
+    }
+    avio_flush(pb);
+    ret = pb->error;
+    ff_format_io_close(s, &pb);
+    return ret;
+}
+
+int ff_seek_index_init(AVFormatContext *s, const char *url,
+                       int (*build)(AVFormatContext *s))
+{
+    int64_t start_time = av_gettime_relative();
+    SeekIndexKey key;
+    int ret, i, nb_entries = 0;
+
+    if (!(s->pb->seekable & AVIO_SEEKABLE_NORMAL))
+        return AVERROR(ENOSYS);
+
+    if (url && url[0]) {
+        if ((ret = seek_index_key(s, &key)) < 0)
+            goto fail;
+        ret = seek_index_load(s, url, &key);
+        if (ret < 0)
+            goto fail;
+        if (ret > 0) {
+            av_log(s, AV_LOG_VERBOSE, "Seek index loaded from '%s'\n", url);
+            return 0;
+        }
+    }
+
+    seek_index_reset(s);
+    if ((ret = avio_seek(s->pb, s->internal->data_offset, SEEK_SET)) < 0 ||
+        (ret = build(s)) < 0)
+        goto fail;
+
+    for (i = 0; i < s->nb_streams; i++)
+        nb_entries += s->streams[i]->nb_index_entries;
+    av_log(s, AV_LOG_VERBOSE, "Seek index of %d keyframes built in %.3f s\n",
+           nb_entries, (av_gettime_relative() - start_time) / 1000000.0);
+
+    if (url && url[0] && (ret = seek_index_save(s, url, &key)) < 0)
+        av_log(s, AV_LOG_WARNING, "Could not write seek index '%s': %s\n",
+               url, av_err2str(ret));
+    return 0;
+
+fail:
+    av_log(s, AV_LOG_WARNING, "No seek index: %s\n", av_err2str(ret));
+    seek_index_reset(s);
+    return ret;
+}
+
+int ff_seek_index_seek(AVFormatContext *s, int stream_index,
+                       int64_t timestamp, int flags)
+{
+    AVStream *st = s->streams[stream_index];
+    const AVIndexEntry *ie;
+    int64_t ret;
+    int index;
+
+    index = av_index_search_timestamp(st, timestamp, flags);
+    if (index < 0)
+        return -1;
+
+    ie = &st->index_entries[index];
+    if ((ret = avio_seek(s->pb, ie->pos, SEEK_SET)) < 0)
+        return ret;
+    ff_update_cur_dts(s, st, ie->timestamp);
+    return 0;
+}
+
+/**
+ * Classify the unit following a start code. hdr points right after the
+ * 00 00 01 prefix, avail bytes are readable from there.
+ */
+static enum ESUnit es_unit_type(enum AVCodecID codec_id, const uint8_t *hdr,
+                                int avail, int *key)
+{
+    int type;
+
+    *key = 0;
+    switch (codec_id) {
+    case AV_CODEC_ID_H264:
+        if (hdr[0] & 0x80)
+            return ES_OTHER;
+        type = hdr[0] & 0x1f;
+        switch (type) {
+        case 1:
+        case 5:
+            *key = type == 5;
+            /* first_mb_in_slice is 0 */
+            return avail < 2 || hdr[1] & 0x80 ? ES_PICTURE : ES_SLICE;
+        case 6: case 7: case 8: case 9:
+        case 13: case 14: case 15: case 16: case 17: case 18:
+            *key = type == 7;
+            return ES_AU_START;
+        }
+        return ES_OTHER;
+    case AV_CODEC_ID_HEVC:
+        if (hdr[0] & 0x80)
+            return ES_OTHER;
+        type = (hdr[0] >> 1) & 0x3f;
+        if (type <= 21) {
+            *key = type >= 16;
+            /* first_slice_segment_in_pic_flag */
+            return avail < 3 || hdr[2] & 0x80 ? ES_PICTURE : ES_SLICE;
+        }
+        if (type >= 32 && type <= 35 || type == 39 ||
+            type >= 41 && type <= 44 || type >= 48 && type <= 55) {
+            *key = type == 32 || type == 33;
+            return ES_AU_START;
+        }
+        return ES_OTHER;
+    case AV_CODEC_ID_MPEG1VIDEO:
+    case AV_CODEC_ID_MPEG2VIDEO:
+        type = hdr[0];
+        if (type == 0x00) {
+            /* picture_coding_type is I */
+            *key = avail >= 3 && ((hdr[2] >> 3) & 7) == 1;
+            return ES_PICTURE;
+        }
+        if (type <= 0xAF)
+            return ES_SLICE;
+        if (type == 0xB3 || type == 0xB8) {
+            *key = 1;
+            return ES_AU_START;
+        }
+        return ES_OTHER;
+    }
+    return ES_OTHER;
+}
+
+static int es_codec_supported(enum AVCodecID codec_id)
+{
+    return codec_id == AV_CODEC_ID_H264 || codec_id == AV_CODEC_ID_HEVC ||
+           codec_id == AV_CODEC_ID_MPEG1VIDEO || codec_id == AV_CODEC_ID_MPEG2VIDEO;
+}
+
+int ff_seek_index_is_keyframe(enum AVCodecID codec_id, const uint8_t *buf, int size)
+{
+    const uint8_t *p = buf, *end = buf + size;
+    int key, has_params = 0;
+
+    if (!es_codec_supported(codec_id))
+        return AVERROR(ENOSYS);
+
+    while (end - p > 3) {
+        p = memchr(p + 2, 1, end - p - 3);
+        if (!p)
+            break;
+        if (p[-1] || p[-2]) {
+            p--;
+            continue;
+        }
+        p++;
+        switch (es_unit_type(codec_id, p, end - p, &key)) {
+        case ES_PICTURE:
+        case ES_SLICE:
+            return key;
+        case ES_AU_START:
+            has_params |= key;
+            break;
+        }
+    }
+    /* the payload ended before the first slice */
+    return has_params;
+}
+
+typedef struct ESScan {
+    AVStream *st;
+    int64_t first_dts;
+    int64_t frame_duration;
+    int64_t nb_fields;          /* fields (half frames) since first_dts */
+    int nb_keyframes;
+
+    /* picture whose header is parsed but not yet counted */
+    int     pic_pending;
+    int64_t pic_pos;
+    int     pic_key;
+    int     pic_field;          /* field picture */
+    int     pic_fields;         /* duration of a frame picture in fields */
+    int     pic_frame_num;
+
+    /* first field of a frame whose second field may follow */
+    int     field_pending;
+    int     field_frame_num;
+
+    int     progressive_sequence;
+
+    struct {
+        uint8_t valid;
+        uint8_t frame_mbs_only;
+        uint8_t separate_colour_plane;
+        uint8_t log2_max_frame_num;
+    } sps[32];
+    int8_t pps_sps_id[256];
+} ESScan;
+
+static int es_unescape(uint8_t *dst, const uint8_t *src, int size)
+{
+    int i, len = 0, zeros = 0;
+
+    for (i = 0; i < size; i++) {
+        if (zeros >= 2 && src[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        zeros = src[i] ? 0 : zeros + 1;
+        dst[len++] = src[i];
+    }
+    return len;
+}
+
+/* parse the H.264 units needed to tell field pictures apart */
+static void es_parse_h264(ESScan *sc, const uint8_t *hdr, int avail, int picture)
+{
+    uint8_t rbsp[ES_SLICE_HEADER_SIZE + AV_INPUT_BUFFER_PADDING_SIZE] = { 0 };
+    int type = hdr[0] & 0x1f, pps_id, sps_id;
+    GetBitContext gb;
+
+    if (type == 7) {
+        const uint8_t *end = ff_avc_find_startcode(hdr, hdr + avail);
+        H264SPS sps;
+        if (ff_avc_decode_sps(&sps, hdr + 1, end - hdr - 1) < 0 || sps.id >= 32)
+            return;
+        sc->sps[sps.id].valid                 = 1;
+        sc->sps[sps.id].frame_mbs_only        = sps.frame_mbs_only_flag;
+        sc->sps[sps.id].separate_colour_plane = sps.separate_colour_plane_flag;
+        sc->sps[sps.id].log2_max_frame_num    = sps.log2_max_frame_num;
+        return;
+    }
+    if (type != 8 && !picture)
+        return;
+
+    init_get_bits8(&gb, rbsp, es_unescape(rbsp, hdr + 1,
+                                          FFMIN(avail - 1, ES_SLICE_HEADER_SIZE)));
+    if (type == 8) {
+        pps_id = get_ue_golomb_long(&gb);
+        sps_id = get_ue_golomb_long(&gb);
+        if (pps_id < 256)
+            sc->pps_sps_id[pps_id] = sps_id < 32 ? sps_id : -1;
+        return;
+    }
+
+    get_ue_golomb_long(&gb); /* first_mb_in_slice */
+    get_ue_golomb_long(&gb); /* slice_type */
+    pps_id = get_ue_golomb_long(&gb);
+    if (pps_id >= 256 || sc->pps_sps_id[pps_id] < 0 ||
+        !sc->sps[sc->pps_sps_id[pps_id]].valid)
+        return;
+    sps_id = sc->pps_sps_id[pps_id];
+    if (sc->sps[sps_id].separate_colour_plane)
+        skip_bits(&gb, 2); /* colour_plane_id */
+    sc->pic_frame_num = get_bits(&gb, sc->sps[sps_id].log2_max_frame_num);
+    sc->pic_field     = !sc->sps[sps_id].frame_mbs_only && get_bits1(&gb);
+}
+
+/* parse the MPEG-2 sequence and picture coding extensions */
+static void es_parse_mpeg2_extension(ESScan *sc, const uint8_t *hdr, int avail)
+{
+    int tff, rff, progressive_frame;
+
+    if (avail < 6)
+        return;
+    switch (hdr[1] >> 4) {
+    case 1:
+        sc->progressive_sequence = (hdr[2] >> 3) & 1;
+        break;
+    case 8:
+        if (!sc->pic_pending)
+            break;
+        tff               = hdr[4] >> 7;
+        rff               = (hdr[4] >> 1) & 1;
+        progressive_frame = hdr[5] >> 7;
+        sc->pic_field     = (hdr[3] & 3) != 3;
+        /* as the repeat_pict the parser exports for frame pictures */
+        if (sc->progressive_sequence)
+            sc->pic_fields = rff ? (tff ? 6 : 4) : 2;
+        else
+            sc->pic_fields = rff && progressive_frame ? 3 : 2;
+        break;
+    }
+}
+
+static void es_start_picture(ESScan *sc, int64_t pos, int key)
+{
+    sc->pic_pending   = 1;
+    sc->pic_pos       = pos;
+    sc->pic_key       = key;
+    sc->pic_field     = 0;
+    sc->pic_fields    = 2;
+    sc->pic_frame_num = 0;
+}
+
+/* count the pending picture, indexing it if it starts a keyframe */
+static int es_end_picture(ESScan *sc)
+{
+    int ret;
+
+    if (!sc->pic_pending)
+        return 0;
+    sc->pic_pending = 0;
+
+    if (sc->pic_field) {
+        if (sc->field_pending && sc->pic_frame_num == sc->field_frame_num) {
+            /* second field, its frame is indexed at the first one */
+            sc->field_pending = 0;
+            sc->nb_fields++;
+            return 0;
+        }
+        sc->field_pending   = 1;
+        sc->field_frame_num = sc->pic_frame_num;
+    } else {
+        sc->field_pending = 0;
+    }
+
+    if (sc->pic_key) {
+        ret = av_add_index_entry(sc->st, sc->pic_pos,
+                                 sc->first_dts + sc->nb_fields * sc->frame_duration / 2,
+                                 0, 0, AVINDEX_KEYFRAME);
+        if (ret < 0)
+            return ret;
+        sc->nb_keyframes++;
+    }
+    sc->nb_fields += sc->pic_field ? 1 : sc->pic_fields;
+    return 0;
+}
+
+int ff_seek_index_build_es(AVFormatContext *s, AVStream *st,
+                           int64_t first_dts, int64_t frame_duration)
+{
+    enum AVCodecID codec_id = st->codecpar->codec_id;
+    AVIOContext *pb = s->pb;
+    int64_t buf_pos = avio_tell(pb), au_pos = -1;
+    int len = 0, i = 0, eof = 0, ret = 0;
+    ESScan *sc;
+    uint8_t *buf;
+
+    if (!es_codec_supported(codec_id))
+        return AVERROR(ENOSYS);
+
+    sc  = av_mallocz(sizeof(*sc));
+    buf = av_malloc(ES_SCAN_SIZE);
+    if (!sc || !buf) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    sc->st             = st;
+    sc->first_dts      = first_dts;
+    sc->frame_duration = frame_duration;
+    memset(sc->pps_sps_id, -1, sizeof(sc->pps_sps_id));
+
+    while (!eof) {
+        int last;
+
+        ret = avio_read(pb, buf + len, ES_SCAN_SIZE - len);
+        if (ret == AVERROR_EOF || ret == 0) {
+            eof = 1;
+        } else if (ret < 0) {
+            goto end;
+        } else {
+            len += ret;
+        }
+
+        /* last position a start code can begin at with enough data after it */
+        last = eof ? len - 4 : len - ES_LOOKAHEAD;
+        while (i <= last) {
+            const uint8_t *p = memchr(buf + i + 2, 1, last - i + 1);
+            const uint8_t *hdr;
+            enum ESUnit unit;
+            int64_t pos;
+            int key, avail;
+
+            if (!p) {
+                i = last + 1;
+                break;
+            }
+            i = p - buf - 2;
+            if (buf[i] || buf[i + 1]) {
+                i++;
+                continue;
+            }
+            /* a zero byte before the prefix belongs to the start code */
+            pos   = buf_pos + i - (i > 0 && !buf[i - 1]);
+            hdr   = buf + i + 3;
+            avail = len - i - 3;
+
+            unit = es_unit_type(codec_id, hdr, avail, &key);
+            if (unit != ES_OTHER && (ret = es_end_picture(sc)) < 0)
+                goto end;
+            switch (unit) {
+            case ES_AU_START:
+                if (au_pos < 0)
+                    au_pos = pos;
+                break;
+            case ES_PICTURE:
+                es_start_picture(sc, au_pos < 0 ? pos : au_pos, key);
+                au_pos = -1;
+                break;
+            }
+
+            if (codec_id == AV_CODEC_ID_H264)
+                es_parse_h264(sc, hdr, avail, unit == ES_PICTURE);
+            else if (codec_id == AV_CODEC_ID_MPEG2VIDEO && hdr[0] == 0xB5)
+                es_parse_mpeg2_extension(sc, hdr, avail);
+            i += 3;
+        }
+
+        /* keep the unscanned tail and the byte before it */
+        if (i > 1) {
+            memmove(buf, buf + i - 1, len - i + 1);
+            buf_pos += i - 1;
+            len     -= i - 1;
+            i        = 1;
+        }
+    }
+    if ((ret = es_end_picture(sc)) >= 0)
+        ret = sc->nb_keyframes;
+
+end:
+    av_free(sc);
+    av_free(buf);
+    return ret;
+}
@@ -0,0 +1,79 @@
+/*
+ * Precomputed keyframe index for seeking in files without one
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_SEEKINDEX_H
+#define AVFORMAT_SEEKINDEX_H
+
+#include <stdint.h>
+
+#include "libavcodec/avcodec.h"
+#include "avformat.h"
+
+/**
+ * Demuxers without an index of their own (MPEG-TS, raw elementary streams)
+ * can build one with a single pass over the whole file the first time a
+ * seek is requested. The keyframes found are stored as regular index
+ * entries of the streams, so that a seek becomes a lookup followed by a
+ * single avio_seek(). The index can be cached in a file next to the input.
+ */
+
+/**
+ * Make the index ready: load it from the index file at url if there is one
+ * for this input, otherwise drop the existing index entries, call build()
+ * to add an entry for every keyframe from s->internal->data_offset on and
+ * write the result to url.
+ *
+ * @param url index file or NULL
+ * @return 0 once the index is ready, a negative error code otherwise; the
+ *         index entries are then left empty
+ */
+int ff_seek_index_init(AVFormatContext *s, const char *url,
+                       int (*build)(AVFormatContext *s));
+
+/**
+ * Seek to the index entry matching timestamp in the given stream, as
+ * ff_seek_frame_generic() does but without reading ahead when the target
+ * is past the last entry.
+ *
+ * @return 0 on success, a negative value if the stream has no usable entry
+ */
+int ff_seek_index_seek(AVFormatContext *s, int stream_index,
+                       int64_t timestamp, int flags);
+
+/**
+ * Check whether an elementary stream payload chunk, e.g. the start of a PES
+ * packet, begins a keyframe: it holds an IDR or IRAP slice or a parameter
+ * set for H.264 and HEVC, a sequence or GOP header for MPEG-1/2 video.
+ */
+int ff_seek_index_is_keyframe(enum AVCodecID codec_id, const uint8_t *buf, int size);
+
+/**
+ * Add an index entry for every keyframe of the raw H.264, HEVC or MPEG-1/2
+ * video elementary stream in s->pb, from the current position to the end of
+ * the file. Frames are assumed to be frame_duration apart, starting at
+ * first_dts, which is how timestamps are derived for these streams; field
+ * pictures and repeated fields (H.264, MPEG-2) last half a frame each.
+ *
+ * @return the number of keyframes found or a negative error code
+ */
+int ff_seek_index_build_es(AVFormatContext *s, AVStream *st,
+                           int64_t first_dts, int64_t frame_duration);
+
+#endif /* AVFORMAT_SEEKINDEX_H */
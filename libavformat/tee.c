@@ -23,6 +23,9 @@
 #include "libavutil/avutil.h"
 #include "libavutil/avstring.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
+#include "libavutil/threadmessage.h"
+#include "libavutil/time.h"
 #include "internal.h"
 #include "avformat.h"
 #include "avio_internal.h"
@@ -35,6 +38,19 @@ typedef enum {
 
 #define DEFAULT_SLAVE_FAILURE_POLICY ON_SLAVE_FAILURE_ABORT
 
+typedef enum {
+    ON_QUEUE_OVERFLOW_BLOCK = 0,
+    ON_QUEUE_OVERFLOW_DROP  = 1
+} QueueOverflowPolicy;
+
+#define DEFAULT_THREAD_QUEUE_SIZE 64
+
+typedef struct TeeMessage {
+    AVPacket pkt;
+    int64_t queued_time; ///< av_gettime_relative() when the packet was queued
+    int flush;           ///< flush the slave instead of writing pkt
+} TeeMessage;
+
 typedef struct {
     AVFormatContext *avf;
     AVBSFContext **bsfs; ///< bitstream filters per stream
@@ -47,6 +63,24 @@ typedef struct {
      * disabled output streams are set to -1 */
     int *stream_map;
     int header_written;
+
+    int use_threads;
+    int thread_queue_size;
+    QueueOverflowPolicy thread_overflow;
+#if HAVE_THREADS
+    AVThreadMessageQueue *queue;
+    pthread_t thread;
+    int thread_started;
+    int thread_ret;           ///< error which stopped the worker thread
+#endif
+    uint8_t *drop_until_keyframe; ///< per stream, set when a packet of the stream was
+                                  ///< dropped, reset by the stream's next keyframe
+
+    /* statistics of the threaded mode */
+    int64_t nb_written;
+    int64_t nb_dropped;
+    int64_t total_latency;
+    int64_t max_latency;
 } TeeSlave;
 
 typedef struct TeeContext {
@@ -56,6 +90,9 @@ typedef struct TeeContext {
     TeeSlave *slaves;
     int use_fifo;
     AVDictionary *fifo_options;
+    int use_threads;
+    int thread_queue_size;
+    int thread_overflow;
 } TeeContext;
 
 static const char *const slave_delim     = "|";
@@ -68,6 +105,14 @@ static const AVOption options[] = {
          OFFSET(use_fifo), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
         {"fifo_options", "fifo pseudo-muxer options", OFFSET(fifo_options),
          AV_OPT_TYPE_DICT, {.str = NULL}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM},
+        {"use_threads", "Write each slave output from its own thread",
+         OFFSET(use_threads), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
+        {"queue_size", "Number of packets queued for each slave thread",
+         OFFSET(thread_queue_size), AV_OPT_TYPE_INT, {.i64 = DEFAULT_THREAD_QUEUE_SIZE}, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
+        {"queue_overflow", "Behaviour when a slave queue is full",
+         OFFSET(thread_overflow), AV_OPT_TYPE_INT, {.i64 = ON_QUEUE_OVERFLOW_BLOCK}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM, "queue_overflow"},
+            {"block", "wait until the slave catches up", 0, AV_OPT_TYPE_CONST, {.i64 = ON_QUEUE_OVERFLOW_BLOCK}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "queue_overflow"},
+            {"drop",  "drop packets up to the next keyframe", 0, AV_OPT_TYPE_CONST, {.i64 = ON_QUEUE_OVERFLOW_DROP}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "queue_overflow"},
         {NULL}
 };
 
@@ -118,18 +163,187 @@ static int parse_slave_fifo_options(const char *use_fifo,
     return ret;
 }
 
+static int parse_slave_thread_options(const char *use_threads, const char *queue_size,
+                                      const char *overflow, TeeSlave *tee_slave)
+{
+    if (use_threads) {
+        if (av_match_name(use_threads, "true,y,yes,enable,enabled,on,1")) {
+            tee_slave->use_threads = 1;
+        } else if (av_match_name(use_threads, "false,n,no,disable,disabled,off,0")) {
+            tee_slave->use_threads = 0;
+        } else {
+            return AVERROR(EINVAL);
+        }
+    }
+
+    if (queue_size) {
+        char *end;
+        long size = strtol(queue_size, &end, 10);
+        if (*end || size < 1 || size > INT_MAX)
+            return AVERROR(EINVAL);
+        tee_slave->thread_queue_size = size;
+    }
+
+    if (overflow) {
+        if (!av_strcasecmp(overflow, "block")) {
+            tee_slave->thread_overflow = ON_QUEUE_OVERFLOW_BLOCK;
+        } else if (!av_strcasecmp(overflow, "drop")) {
+            tee_slave->thread_overflow = ON_QUEUE_OVERFLOW_DROP;
+        } else {
+            return AVERROR(EINVAL);
+        }
+    }
+
+    return 0;
+}
+
+static int tee_slave_write_packet(void *log_ctx, TeeSlave *tee_slave, AVPacket *pkt)
+{
+    AVFormatContext *avf2 = tee_slave->avf;
+    int s2 = pkt->stream_index;
+    AVBSFContext *bsfs = tee_slave->bsfs[s2];
+    int ret;
+
+    ret = av_bsf_send_packet(bsfs, pkt);
+    if (ret < 0) {
+        av_log(log_ctx, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
+               av_err2str(ret));
+        av_packet_unref(pkt);
+        return ret;
+    }
+
+    while(1) {
+        ret = av_bsf_receive_packet(bsfs, pkt);
+        if (ret == AVERROR(EAGAIN)) {
+            ret = 0;
+            break;
+        } else if (ret < 0) {
+            break;
+        }
+
+        av_packet_rescale_ts(pkt, bsfs->time_base_out,
+                             avf2->streams[s2]->time_base);
+        ret = av_interleaved_write_frame(avf2, pkt);
+        if (ret < 0)
+            break;
+    };
+
+    return ret;
+}
+
+#if HAVE_THREADS
+static void free_message(void *msg)
+{
+    TeeMessage *tee_msg = msg;
+    av_packet_unref(&tee_msg->pkt);
+}
+
+static void *slave_writer_thread(void *arg)
+{
+    TeeSlave *tee_slave = arg;
+    TeeMessage msg;
+    int ret;
+
+    while ((ret = av_thread_message_queue_recv(tee_slave->queue, &msg, 0)) >= 0) {
+        if (msg.flush) {
+            ret = av_interleaved_write_frame(tee_slave->avf, NULL);
+        } else {
+            int64_t latency;
+
+            ret = tee_slave_write_packet(tee_slave->avf, tee_slave, &msg.pkt);
+            latency = av_gettime_relative() - msg.queued_time;
+            tee_slave->nb_written++;
+            tee_slave->total_latency += latency;
+            tee_slave->max_latency = FFMAX(tee_slave->max_latency, latency);
+        }
+        if (ret < 0)
+            break;
+    }
+
+    if (ret == AVERROR_EOF)
+        ret = 0;
+    tee_slave->thread_ret = ret;
+    /* Wake up and fail a muxing thread waiting for queue space, packets
+     * still in the queue are freed with it. */
+    if (ret < 0)
+        av_thread_message_queue_set_err_send(tee_slave->queue, ret);
+    return NULL;
+}
+
+static int start_slave_thread(AVFormatContext *avf, TeeSlave *tee_slave)
+{
+    int ret;
+
+    tee_slave->drop_until_keyframe = av_mallocz(tee_slave->avf->nb_streams);
+    if (!tee_slave->drop_until_keyframe)
+        return AVERROR(ENOMEM);
+
+    ret = av_thread_message_queue_alloc(&tee_slave->queue, tee_slave->thread_queue_size,
+                                        sizeof(TeeMessage));
+    if (ret < 0)
+        return ret;
+    av_thread_message_queue_set_free_func(tee_slave->queue, free_message);
+
+    ret = pthread_create(&tee_slave->thread, NULL, slave_writer_thread, tee_slave);
+    if (ret) {
+        av_log(avf, AV_LOG_ERROR, "Failed to start thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        av_thread_message_queue_free(&tee_slave->queue);
+        return AVERROR(ret);
+    }
+    tee_slave->thread_started = 1;
+    return 0;
+}
+
+/**
+ * Let the worker thread write out all queued packets (or give up after an
+ * error) and wait for it.
+ *
+ * @return the error which stopped the thread, 0 if none
+ */
+static int stop_slave_thread(TeeSlave *tee_slave)
+{
+    int ret;
+
+    if (!tee_slave->thread_started)
+        return 0;
+
+    av_thread_message_queue_set_err_recv(tee_slave->queue, AVERROR_EOF);
+    ret = pthread_join(tee_slave->thread, NULL);
+    tee_slave->thread_started = 0;
+    av_thread_message_queue_free(&tee_slave->queue);
+    if (ret)
+        return AVERROR(ret);
+
+    av_log(tee_slave->avf, AV_LOG_VERBOSE,
+           "%"PRId64" packets written, %"PRId64" dropped, "
+           "queue latency avg %.3f ms max %.3f ms\n",
+           tee_slave->nb_written, tee_slave->nb_dropped,
+           tee_slave->nb_written ? tee_slave->total_latency / (tee_slave->nb_written * 1000.0) : 0.0,
+           tee_slave->max_latency / 1000.0);
+    return tee_slave->thread_ret;
+}
+#endif
+
 static int close_slave(TeeSlave *tee_slave)
 {
     AVFormatContext *avf;
     unsigned i;
-    int ret = 0;
+    int ret = 0, ret2;
 
     avf = tee_slave->avf;
     if (!avf)
         return 0;
 
-    if (tee_slave->header_written)
-        ret = av_write_trailer(avf);
+#if HAVE_THREADS
+    ret = stop_slave_thread(tee_slave);
+#endif
+
+    if (tee_slave->header_written) {
+        ret2 = av_write_trailer(avf);
+        if (ret >= 0)
+            ret = ret2;
+    }
 
     if (tee_slave->bsfs) {
         for (i = 0; i < avf->nb_streams; ++i)
@@ -137,6 +351,7 @@ static int close_slave(TeeSlave *tee_slave)
     }
     av_freep(&tee_slave->stream_map);
     av_freep(&tee_slave->bsfs);
+    av_freep(&tee_slave->drop_until_keyframe);
 
     ff_format_io_close(avf, &avf->pb);
     avformat_free_context(avf);
@@ -163,6 +378,7 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     char *filename;
     char *format = NULL, *select = NULL, *on_fail = NULL;
     char *use_fifo = NULL, *fifo_options_str = NULL;
+    char *use_threads = NULL, *thread_queue_size = NULL, *thread_overflow = NULL;
     AVFormatContext *avf2 = NULL;
     AVStream *st, *st2;
     int stream_count;
@@ -185,6 +401,9 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
     STEAL_OPTION("onfail", on_fail);
     STEAL_OPTION("use_fifo", use_fifo);
     STEAL_OPTION("fifo_options", fifo_options_str);
+    STEAL_OPTION("use_threads", use_threads);
+    STEAL_OPTION("queue_size", thread_queue_size);
+    STEAL_OPTION("queue_overflow", thread_overflow);
     entry = NULL;
     while ((entry = av_dict_get(options, "bsfs", entry, AV_DICT_IGNORE_SUFFIX))) {
         /* trim out strlen("bsfs") characters from key */
@@ -205,6 +424,19 @@ static int open_slave(AVFormatContext *avf, char *slave, TeeSlave *tee_slave)
         goto end;
     }
 
+    ret = parse_slave_thread_options(use_threads, thread_queue_size, thread_overflow, tee_slave);
+    if (ret < 0) {
+        av_log(avf, AV_LOG_ERROR, "Error parsing thread options: %s\n", av_err2str(ret));
+        goto end;
+    }
+#if !HAVE_THREADS
+    if (tee_slave->use_threads) {
+        av_log(avf, AV_LOG_ERROR, "Threaded slave output requires thread support\n");
+        ret = AVERROR(ENOSYS);
+        goto end;
+    }
+#endif
+
     if (tee_slave->use_fifo) {
 
         if (options) {
@@ -403,6 +635,9 @@ end:
     av_free(format);
     av_free(select);
     av_free(on_fail);
+    av_free(use_threads);
+    av_free(thread_queue_size);
+    av_free(thread_overflow);
     av_dict_free(&options);
     av_dict_free(&bsf_options);
     av_freep(&tmp_select);
@@ -486,8 +721,16 @@ static int tee_write_header(AVFormatContext *avf)
         ret = av_dict_copy(&tee->slaves[i].fifo_options, tee->fifo_options, 0);
         if (ret < 0)
             goto fail;
-
-        if ((ret = open_slave(avf, slaves[i], &tee->slaves[i])) < 0) {
+        tee->slaves[i].use_threads       = tee->use_threads;
+        tee->slaves[i].thread_queue_size = tee->thread_queue_size;
+        tee->slaves[i].thread_overflow   = tee->thread_overflow;
+
+        ret = open_slave(avf, slaves[i], &tee->slaves[i]);
+#if HAVE_THREADS
+        if (ret >= 0 && tee->slaves[i].use_threads)
+            ret = start_slave_thread(avf, &tee->slaves[i]);
+#endif
+        if (ret < 0) {
             ret = tee_process_slave_failure(avf, i, ret);
             if (ret < 0)
                 goto fail;
@@ -534,20 +777,80 @@ static int tee_write_trailer(AVFormatContext *avf)
     return ret_all;
 }
 
+#if HAVE_THREADS
+static int tee_queue_packet(AVFormatContext *avf, TeeSlave *tee_slave, AVPacket *pkt, int s2)
+{
+    TeeMessage msg = { .flush = !pkt };
+    int ret;
+
+    if (pkt) {
+        if (tee_slave->drop_until_keyframe[s2]) {
+            if (!(pkt->flags & AV_PKT_FLAG_KEY)) {
+                tee_slave->nb_dropped++;
+                return 0;
+            }
+            tee_slave->drop_until_keyframe[s2] = 0;
+        }
+        ret = av_packet_ref(&msg.pkt, pkt);
+        if (ret < 0)
+            return ret;
+        msg.pkt.stream_index = s2;
+        msg.queued_time = av_gettime_relative();
+    }
+
+    ret = av_thread_message_queue_send(tee_slave->queue, &msg,
+                                       pkt && tee_slave->thread_overflow == ON_QUEUE_OVERFLOW_DROP ?
+                                       AV_THREAD_MESSAGE_NONBLOCK : 0);
+    if (ret == AVERROR(EAGAIN)) {
+        av_log(avf, AV_LOG_WARNING, "Queue of slave '%s' full, dropping packets "
+               "of stream %d until its next keyframe\n", tee_slave->avf->url, s2);
+        tee_slave->nb_dropped++;
+        tee_slave->drop_until_keyframe[s2] = 1;
+        av_packet_unref(&msg.pkt);
+        ret = 0;
+    }
+    if (ret < 0)
+        av_packet_unref(&msg.pkt);
+    return ret;
+}
+#endif
+
 static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
 {
     TeeContext *tee = avf->priv_data;
     AVFormatContext *avf2;
-    AVBSFContext *bsfs;
-    AVPacket pkt2;
+    AVPacket pkt2, shared;
     int ret_all = 0, ret;
     unsigned i, s;
     int s2;
 
+    /* Make the payload refcounted once, so that it is shared by the slaves
+     * instead of being copied for each of them. */
+    if (pkt && !pkt->buf) {
+        if ((ret = av_packet_ref(&shared, pkt)) < 0)
+            return ret;
+        pkt = &shared;
+    }
+
     for (i = 0; i < tee->nb_slaves; i++) {
         if (!(avf2 = tee->slaves[i].avf))
             continue;
 
+#if HAVE_THREADS
+        if (tee->slaves[i].thread_started) {
+            s2 = pkt ? tee->slaves[i].stream_map[pkt->stream_index] : 0;
+            if (s2 < 0)
+                continue;
+            ret = tee_queue_packet(avf, &tee->slaves[i], pkt, s2);
+            if (ret < 0) {
+                ret = tee_process_slave_failure(avf, i, ret);
+                if (!ret_all && ret < 0)
+                    ret_all = ret;
+            }
+            continue;
+        }
+#endif
+
         /* Flush slave if pkt is NULL*/
         if (!pkt) {
             ret = av_interleaved_write_frame(avf2, NULL);
@@ -569,40 +872,17 @@ static int tee_write_packet(AVFormatContext *avf, AVPacket *pkt)
                 ret_all = ret;
                 continue;
             }
-        bsfs = tee->slaves[i].bsfs[s2];
         pkt2.stream_index = s2;
 
-        ret = av_bsf_send_packet(bsfs, &pkt2);
-        if (ret < 0) {
-            av_log(avf, AV_LOG_ERROR, "Error while sending packet to bitstream filter: %s\n",
-                   av_err2str(ret));
-            ret = tee_process_slave_failure(avf, i, ret);
-            if (!ret_all && ret < 0)
-                ret_all = ret;
-        }
-
-        while(1) {
-            ret = av_bsf_receive_packet(bsfs, &pkt2);
-            if (ret == AVERROR(EAGAIN)) {
-                ret = 0;
-                break;
-            } else if (ret < 0) {
-                break;
-            }
-
-            av_packet_rescale_ts(&pkt2, bsfs->time_base_out,
-                                 avf2->streams[s2]->time_base);
-            ret = av_interleaved_write_frame(avf2, &pkt2);
-            if (ret < 0)
-                break;
-        };
-
+        ret = tee_slave_write_packet(avf, &tee->slaves[i], &pkt2);
         if (ret < 0) {
             ret = tee_process_slave_failure(avf, i, ret);
             if (!ret_all && ret < 0)
                 ret_all = ret;
         }
     }
+    if (pkt == &shared)
+        av_packet_unref(&shared);
     return ret_all;
 }
 
@@ -0,0 +1,54 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Read through the async protocol and close it, both after the end of the
+ * input and in the middle of it. Closing a reader stops the background
+ * thread, which must not be reported as an error.
+ */
+
+#include <stdio.h>
+
+#include "libavformat/avio.h"
+
+#define URL "async:data:,0123456789abcdefghijklmnopqrstuvwxyz"
+
+static int read_and_close(int size)
+{
+    AVIOContext *pb = NULL;
+    unsigned char buf[64];
+    int ret, len;
+
+    ret = avio_open2(&pb, URL, AVIO_FLAG_READ, NULL, NULL);
+    if (ret < 0)
+        return ret;
+    len = avio_read(pb, buf, size);
+    printf("read %d: %.*s\n", size, len > 0 ? len : 0, buf);
+    return avio_closep(&pb);
+}
+
+int main(void)
+{
+    int ret;
+
+    ret = read_and_close(64);
+    printf("close after the end: %d\n", ret);
+    ret = read_and_close(10);
+    printf("close in the middle: %d\n", ret);
+    return 0;
+}
@@ -0,0 +1,242 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Upload through the pool to local servers. A server that drops the kept
+ * alive connection makes the next upload fail to reuse the pooled
+ * connection and connect again. Servers that keep it alive must get all
+ * their uploads on one connection, and a pooled connection must never be
+ * handed to an upload for another server. All requests must carry the
+ * caller's method and headers.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/thread.h"
+#include "libavformat/avformat.h"
+#include "libavformat/httppool.h"
+#include "libavformat/network.h"
+
+#define MAX_REQUESTS 4
+
+typedef struct Server {
+    int fd;
+    int port;
+    int keep_alive;
+    pthread_t thread;
+
+    int  nb_connections;
+    int  nb_requests;
+    char request_lines[MAX_REQUESTS][64];
+    int  request_tagged[MAX_REQUESTS];
+} Server;
+
+static int fallback_opens;
+static int nb_errors;
+
+static int recv_until(int fd, char *buf, int size, const char *end)
+{
+    int len = 0;
+
+    while (len < size - 1) {
+        int ret = recv(fd, buf + len, 1, 0);
+        if (ret <= 0)
+            return -1;
+        buf[++len] = 0;
+        if (len >= strlen(end) && !strcmp(buf + len - strlen(end), end))
+            return len;
+    }
+    return -1;
+}
+
+static int send_str(int fd, const char *str)
+{
+    return send(fd, str, strlen(str), 0) == strlen(str) ? 0 : -1;
+}
+
+/* Answer one chunked upload with Expect: 100-continue. */
+static int serve_request(Server *srv, int fd)
+{
+    int n = srv->nb_requests;
+    char buf[4096];
+    char *eol;
+
+    if (recv_until(fd, buf, sizeof(buf), "\r\n\r\n") < 0)
+        return -1;
+    eol = strstr(buf, "\r\n");
+    av_strlcpy(srv->request_lines[n], buf, FFMIN(sizeof(srv->request_lines[n]), eol - buf + 1));
+    srv->request_tagged[n] = !!strstr(buf, "\r\nX-Pool-Test: 1\r\n");
+    srv->nb_requests++;
+
+    if (send_str(fd, "HTTP/1.1 100 Continue\r\n\r\n") < 0 ||
+        recv_until(fd, buf, sizeof(buf), "\r\n0\r\n\r\n") < 0 ||
+        send_str(fd, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n") < 0)
+        return -1;
+    return 0;
+}
+
+static void *server_thread(void *arg)
+{
+    Server *srv = arg;
+
+    for (;;) {
+        int fd = accept(srv->fd, NULL, NULL);
+        if (fd < 0)
+            break;
+        srv->nb_connections++;
+        /* without keep alive, drop the connection although it was kept alive */
+        while (srv->nb_requests < MAX_REQUESTS &&
+               !serve_request(srv, fd) && srv->keep_alive)
+            ;
+        closesocket(fd);
+    }
+    return NULL;
+}
+
+static int start_server(Server *srv, int keep_alive)
+{
+    struct sockaddr_in addr = { 0 };
+    socklen_t addr_len = sizeof(addr);
+
+    memset(srv, 0, sizeof(*srv));
+    srv->keep_alive = keep_alive;
+
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    srv->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (srv->fd < 0 ||
+        bind(srv->fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+        listen(srv->fd, 1) ||
+        getsockname(srv->fd, (struct sockaddr *)&addr, &addr_len)) {
+        fprintf(stderr, "Cannot listen on a local socket\n");
+        return -1;
+    }
+    srv->port = ntohs(addr.sin_port);
+    return pthread_create(&srv->thread, NULL, server_thread, srv) ? -1 : 0;
+}
+
+static void stop_server(Server *srv, const char *name)
+{
+    int i;
+
+    shutdown(srv->fd, SHUT_RDWR);
+    pthread_join(srv->thread, NULL);
+    closesocket(srv->fd);
+
+    printf("server %s: %d connection(s)\n", name, srv->nb_connections);
+    for (i = 0; i < srv->nb_requests; i++)
+        printf("  request %d: %s, header %s\n", i, srv->request_lines[i],
+               srv->request_tagged[i] ? "present" : "missing");
+}
+
+static int (*default_io_open)(AVFormatContext *s, AVIOContext **pb, const char *url,
+                              int flags, AVDictionary **options);
+
+static int count_io_open(AVFormatContext *s, AVIOContext **pb, const char *url,
+                         int flags, AVDictionary **options)
+{
+    fallback_opens++;
+    return default_io_open(s, pb, url, flags, options);
+}
+
+static void count_errors(void *avcl, int level, const char *fmt, va_list vl)
+{
+    if (level <= AV_LOG_ERROR)
+        nb_errors++;
+}
+
+static int upload(AVFormatContext *s, HTTPPool *pool, Server *srv, int n)
+{
+    AVIOContext *pb = NULL;
+    AVDictionary *options = NULL;
+    char url[64];
+    int ret;
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/seg%d.ts", srv->port, n);
+    av_dict_set(&options, "method", "PUT", 0);
+    av_dict_set(&options, "headers", "X-Pool-Test: 1\r\n", 0);
+    av_dict_set(&options, "send_expect_100", "1", 0);
+    av_dict_set(&options, "multiple_requests", "1", 0);
+
+    ret = ff_http_pool_open(s, pool, &pb, url, &options);
+    av_dict_free(&options);
+    if (ret >= 0) {
+        avio_write(pb, "data", 4);
+        ret = ff_http_pool_release(s, pool, &pb, 1);
+    }
+    if (ret < 0)
+        fprintf(stderr, "Upload %d failed: %s\n", n, av_err2str(ret));
+    return ret;
+}
+
+static void print_counters(const char *test, int log_errors)
+{
+    printf("%s: connections opened: %d", test, fallback_opens);
+    if (log_errors)
+        printf(", errors logged: %d", nb_errors);
+    printf("\n");
+    fallback_opens = nb_errors = 0;
+}
+
+int main(void)
+{
+    AVFormatContext *s;
+    HTTPPool pool = { 0 };
+    Server a, b;
+    int ret = 0;
+
+    avformat_network_init();
+
+    s = avformat_alloc_context();
+    if (!s || !(s->url = av_strdup("")))
+        return 1;
+    default_io_open = s->io_open;
+    s->io_open      = count_io_open;
+
+    /* the server closes the pooled connection */
+    if (start_server(&a, 0) < 0)
+        return 1;
+    if ((ret = upload(s, &pool, &a, 0)) >= 0)
+        ret = upload(s, &pool, &a, 1);
+    ff_http_pool_close(s, &pool);
+    stop_server(&a, "dropping");
+    print_counters("dropped connection", 0);
+
+    /* uploads alternating between two servers, each reusing its connection */
+    av_log_set_callback(count_errors);
+    if (start_server(&a, 1) < 0 || start_server(&b, 1) < 0)
+        return 1;
+    if (ret >= 0)
+        ret = upload(s, &pool, &a, 0);
+    if (ret >= 0)
+        ret = upload(s, &pool, &b, 1);
+    if (ret >= 0)
+        ret = upload(s, &pool, &a, 2);
+    if (ret >= 0)
+        ret = upload(s, &pool, &b, 3);
+    ff_http_pool_close(s, &pool);
+    stop_server(&a, "A");
+    stop_server(&b, "B");
+    print_counters("reused connections", 1);
+
+    avformat_free_context(s);
+    avformat_network_deinit();
+    return ret < 0;
+}
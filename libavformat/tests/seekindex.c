@@ -0,0 +1,353 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Index small interlaced MPEG-2 and H.264 elementary streams made of field
+ * pairs, plain frames and repeated fields, then check that a cached index
+ * is only reused for the same input.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/mem.h"
+#include "libavcodec/put_bits.h"
+#include "libavformat/avformat.h"
+#include "libavformat/avio_internal.h"
+#include "libavformat/seekindex.h"
+
+#define FRAME_DURATION 40
+
+static uint8_t stream_buf[4096];
+static int stream_size;
+
+static uint8_t *index_buf;
+static int index_size;
+static int nb_builds;
+
+static void put_start_code(int type)
+{
+    stream_buf[stream_size++] = 0;
+    stream_buf[stream_size++] = 0;
+    stream_buf[stream_size++] = 1;
+    stream_buf[stream_size++] = type;
+}
+
+static void put_bytes(const uint8_t *data, int size)
+{
+    memcpy(stream_buf + stream_size, data, size);
+    stream_size += size;
+}
+
+/* payload bytes that do not contain a start code */
+static void put_filler(void)
+{
+    static const uint8_t filler[] = { 0x5a, 0xa5, 0x5a, 0xa5, 0x5a, 0xa5, 0x5a, 0xa5 };
+    put_bytes(filler, sizeof(filler));
+}
+
+static void mpeg2_picture(int coding_type, int structure, int tff, int rff,
+                          int progressive_frame)
+{
+    uint8_t pic[] = { 0x00, coding_type << 3, 0xff, 0xf8 };
+    uint8_t ext[] = { 0x8f, 0xff, 0xf0 | structure,
+                      tff << 7 | rff << 1, progressive_frame << 7, 0x00 };
+
+    put_start_code(0x00);
+    put_bytes(pic, sizeof(pic));
+    put_start_code(0xb5);
+    put_bytes(ext, sizeof(ext));
+    put_start_code(0x01);
+    put_filler();
+    put_start_code(0x02);
+    put_filler();
+}
+
+static void mpeg2_gop(void)
+{
+    /* sequence header, sequence extension with progressive_sequence 0, GOP */
+    static const uint8_t seq[] = { 0x16, 0x00, 0xf0, 0x13, 0xff, 0xff, 0xe0, 0x18 };
+    static const uint8_t seq_ext[] = { 0x14, 0x82, 0x00, 0x01, 0x00, 0x00 };
+    static const uint8_t gop[] = { 0x00, 0x08, 0x00, 0x00 };
+
+    put_start_code(0xb3);
+    put_bytes(seq, sizeof(seq));
+    put_start_code(0xb5);
+    put_bytes(seq_ext, sizeof(seq_ext));
+    put_start_code(0xb8);
+    put_bytes(gop, sizeof(gop));
+}
+
+static void make_mpeg2(void)
+{
+    stream_size = 0;
+    mpeg2_gop();
+    mpeg2_picture(1, 1, 1, 0, 0);   /* I top field */
+    mpeg2_picture(2, 2, 1, 0, 0);   /* P bottom field */
+    mpeg2_picture(2, 3, 1, 0, 0);   /* P frame */
+    mpeg2_picture(2, 3, 1, 1, 1);   /* P frame, three fields */
+    mpeg2_gop();
+    mpeg2_picture(1, 3, 0, 0, 0);   /* I frame */
+    mpeg2_picture(2, 2, 0, 0, 0);   /* P bottom field */
+    mpeg2_picture(2, 1, 0, 0, 0);   /* P top field */
+    mpeg2_gop();
+    mpeg2_picture(1, 3, 1, 0, 0);   /* I frame */
+}
+
+static void h264_nal(int nal_header, const uint8_t *rbsp, int size)
+{
+    stream_buf[stream_size++] = 0;
+    put_start_code(nal_header);
+    put_bytes(rbsp, size);
+}
+
+static void h264_parameter_sets(void)
+{
+    uint8_t sps[8], pps[4];
+    PutBitContext pb;
+
+    init_put_bits(&pb, sps, sizeof(sps));
+    put_bits(&pb, 8, 77);       /* profile_idc */
+    put_bits(&pb, 8, 0);        /* constraint_set_flags */
+    put_bits(&pb, 8, 30);       /* level_idc */
+    put_bits(&pb, 1, 1);        /* seq_parameter_set_id 0 */
+    put_bits(&pb, 1, 1);        /* log2_max_frame_num_minus4 0 */
+    put_bits(&pb, 3, 3);        /* pic_order_cnt_type 2 */
+    put_bits(&pb, 3, 2);        /* max_num_ref_frames 1 */
+    put_bits(&pb, 1, 0);        /* gaps_in_frame_num_value_allowed_flag */
+    put_bits(&pb, 1, 1);        /* pic_width_in_mbs_minus1 0 */
+    put_bits(&pb, 1, 1);        /* pic_height_in_map_units_minus1 0 */
+    put_bits(&pb, 1, 0);        /* frame_mbs_only_flag */
+    put_bits(&pb, 1, 0);        /* mb_adaptive_frame_field_flag */
+    put_bits(&pb, 1, 1);        /* direct_8x8_inference_flag */
+    put_bits(&pb, 1, 0);        /* frame_cropping_flag */
+    put_bits(&pb, 1, 0);        /* vui_parameters_present_flag */
+    put_bits(&pb, 1, 1);        /* rbsp_stop_one_bit */
+    flush_put_bits(&pb);
+    h264_nal(0x67, sps, put_bits_count(&pb) >> 3);
+
+    init_put_bits(&pb, pps, sizeof(pps));
+    put_bits(&pb, 1, 1);        /* pic_parameter_set_id 0 */
+    put_bits(&pb, 1, 1);        /* seq_parameter_set_id 0 */
+    put_bits(&pb, 6, 0x21);     /* the rest does not matter here */
+    flush_put_bits(&pb);
+    h264_nal(0x68, pps, put_bits_count(&pb) >> 3);
+}
+
+/* field is 0 for a frame, 1 for a top and 2 for a bottom field */
+static void h264_picture(int idr, int frame_num, int field)
+{
+    static const uint8_t aud[] = { 0xf0 };
+    uint8_t slice[16];
+    PutBitContext pb;
+
+    h264_nal(0x09, aud, sizeof(aud));
+    if (idr)
+        h264_parameter_sets();
+
+    init_put_bits(&pb, slice, sizeof(slice));
+    put_bits(&pb, 1, 1);        /* first_mb_in_slice 0 */
+    if (idr)
+        put_bits(&pb, 7, 8);    /* slice_type 7 (I) */
+    else
+        put_bits(&pb, 5, 6);    /* slice_type 5 (P) */
+    put_bits(&pb, 1, 1);        /* pic_parameter_set_id 0 */
+    put_bits(&pb, 4, frame_num);
+    put_bits(&pb, 1, !!field);  /* field_pic_flag */
+    if (field)
+        put_bits(&pb, 1, field == 2); /* bottom_field_flag */
+    put_bits(&pb, 16, 0x5aa5);
+    flush_put_bits(&pb);
+    h264_nal(idr ? 0x65 : 0x41, slice, put_bits_count(&pb) >> 3);
+}
+
+static void make_h264(void)
+{
+    stream_size = 0;
+    h264_picture(1, 0, 1);      /* IDR top field */
+    h264_picture(1, 0, 2);      /* IDR bottom field, same frame */
+    h264_picture(0, 1, 0);      /* P frame */
+    h264_picture(0, 2, 1);      /* P field pair */
+    h264_picture(0, 2, 2);
+    h264_picture(1, 0, 0);      /* IDR frame */
+    h264_picture(0, 1, 2);      /* P field pair */
+    h264_picture(0, 1, 1);
+    h264_picture(1, 0, 1);      /* IDR top field */
+}
+
+typedef struct MemReader {
+    const uint8_t *data;
+    int size, pos;
+} MemReader;
+
+static int mem_read(void *opaque, uint8_t *buf, int size)
+{
+    MemReader *r = opaque;
+
+    size = FFMIN(size, r->size - r->pos);
+    if (size <= 0)
+        return AVERROR_EOF;
+    memcpy(buf, r->data + r->pos, size);
+    r->pos += size;
+    return size;
+}
+
+static int64_t mem_seek(void *opaque, int64_t offset, int whence)
+{
+    MemReader *r = opaque;
+
+    if (whence == AVSEEK_SIZE)
+        return r->size;
+    if (whence != SEEK_SET || offset < 0 || offset > r->size)
+        return AVERROR(EINVAL);
+    r->pos = offset;
+    return offset;
+}
+
+static AVIOContext *mem_open(const uint8_t *data, int size)
+{
+    MemReader *r = av_mallocz(sizeof(*r));
+    uint8_t *buf = av_malloc(4096);
+    AVIOContext *pb;
+
+    if (!r || !buf)
+        return NULL;
+    r->data = data;
+    r->size = size;
+    pb = avio_alloc_context(buf, 4096, 0, r, mem_read, NULL, mem_seek);
+    if (pb)
+        pb->seekable = AVIO_SEEKABLE_NORMAL;
+    return pb;
+}
+
+static void mem_close(AVIOContext **pb)
+{
+    if (!*pb)
+        return;
+    av_freep(&(*pb)->opaque);
+    av_freep(&(*pb)->buffer);
+    avio_context_free(pb);
+}
+
+/* the index file lives in memory */
+static int index_io_open(AVFormatContext *s, AVIOContext **pb, const char *url,
+                         int flags, AVDictionary **options)
+{
+    if (flags & AVIO_FLAG_WRITE)
+        return avio_open_dyn_buf(pb);
+    if (!index_buf)
+        return AVERROR(ENOENT);
+    *pb = mem_open(index_buf, index_size);
+    return *pb ? 0 : AVERROR(ENOMEM);
+}
+
+static void index_io_close(AVFormatContext *s, AVIOContext *pb)
+{
+    if (pb->write_flag) {
+        av_freep(&index_buf);
+        index_size = avio_close_dyn_buf(pb, &index_buf);
+    } else {
+        mem_close(&pb);
+    }
+}
+
+static int build(AVFormatContext *s)
+{
+    nb_builds++;
+    return ff_seek_index_build_es(s, s->streams[0], 0, FRAME_DURATION);
+}
+
+static void print_index(const char *name, AVFormatContext *s)
+{
+    AVStream *st = s->streams[0];
+    int i;
+
+    printf("%s:", name);
+    for (i = 0; i < st->nb_index_entries; i++)
+        printf(" %"PRId64"@%"PRId64, st->index_entries[i].timestamp,
+               st->index_entries[i].pos);
+    printf("\n");
+}
+
+static AVFormatContext *open_input(enum AVCodecID codec_id)
+{
+    AVFormatContext *s = avformat_alloc_context();
+    AVStream *st;
+
+    if (!s || !(st = avformat_new_stream(s, NULL)))
+        return NULL;
+    st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    st->codecpar->codec_id   = codec_id;
+    st->time_base            = (AVRational){ 1, 1000 };
+    s->io_open  = index_io_open;
+    s->io_close = index_io_close;
+    s->pb = mem_open(stream_buf, stream_size);
+    return s->pb ? s : NULL;
+}
+
+static void close_input(AVFormatContext **s)
+{
+    mem_close(&(*s)->pb);
+    avformat_free_context(*s);
+    *s = NULL;
+}
+
+int main(void)
+{
+    AVFormatContext *s;
+    int ret = 0;
+
+    make_mpeg2();
+    if (!(s = open_input(AV_CODEC_ID_MPEG2VIDEO)))
+        return 1;
+    ret |= ff_seek_index_init(s, NULL, build);
+    print_index("mpeg2", s);
+    close_input(&s);
+
+    make_h264();
+    if (!(s = open_input(AV_CODEC_ID_H264)))
+        return 1;
+    ret |= ff_seek_index_init(s, NULL, build);
+    print_index("h264", s);
+    close_input(&s);
+
+    /* the index is written, then reused for the same input only */
+    nb_builds = 0;
+    make_mpeg2();
+    if (!(s = open_input(AV_CODEC_ID_MPEG2VIDEO)))
+        return 1;
+    ret |= ff_seek_index_init(s, "index", build);
+    close_input(&s);
+    if (!(s = open_input(AV_CODEC_ID_MPEG2VIDEO)))
+        return 1;
+    ret |= ff_seek_index_init(s, "index", build);
+    print_index("cached", s);
+    close_input(&s);
+    printf("builds for the same input: %d\n", nb_builds);
+
+    /* same size, different content */
+    stream_buf[stream_size - 1] ^= 0xff;
+    if (!(s = open_input(AV_CODEC_ID_MPEG2VIDEO)))
+        return 1;
+    ret |= ff_seek_index_init(s, "index", build);
+    close_input(&s);
+    printf("builds after a change: %d\n", nb_builds);
+
+    av_freep(&index_buf);
+    return ret < 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Queue interleaved video and audio packets for a slave with the drop
+ * overflow policy. The queue is drained here instead of by a writer
+ * thread, so that it overflows at known packets. After an overflow the
+ * video stream must resume at its next keyframe, whatever audio packets
+ * (which are all keyframes) are queued in between.
+ */
+
+#include "libavformat/tee.c"
+
+#define QUEUE_SIZE 3
+
+static void queue(AVFormatContext *avf, TeeSlave *slave, const char *name)
+{
+    AVPacket pkt;
+    int ret;
+
+    av_init_packet(&pkt);
+    pkt.data = (uint8_t *)name;
+    pkt.size = strlen(name) + 1;
+    pkt.flags = name[0] == 'a' || name[0] == 'V' ? AV_PKT_FLAG_KEY : 0;
+
+    ret = tee_queue_packet(avf, slave, &pkt, name[0] != 'a' ? 0 : 1);
+    if (ret < 0)
+        printf("queueing %s failed: %s\n", name, av_err2str(ret));
+}
+
+static void drain(TeeSlave *slave)
+{
+    TeeMessage msg;
+
+    printf("written:");
+    while (av_thread_message_queue_recv(slave->queue, &msg,
+                                        AV_THREAD_MESSAGE_NONBLOCK) >= 0) {
+        printf(" %s", msg.pkt.data);
+        av_packet_unref(&msg.pkt);
+    }
+    printf("\n");
+}
+
+int main(void)
+{
+    AVFormatContext *avf;
+    TeeSlave slave = { 0 };
+    int ret;
+
+    av_log_set_level(AV_LOG_ERROR);
+
+    avf = avformat_alloc_context();
+    slave.avf = avformat_alloc_context();
+    if (!avf || !slave.avf || !(slave.avf->url = av_strdup("test")) ||
+        !avformat_new_stream(slave.avf, NULL) ||
+        !avformat_new_stream(slave.avf, NULL))
+        return 1;
+    slave.thread_overflow = ON_QUEUE_OVERFLOW_DROP;
+    slave.drop_until_keyframe = av_mallocz(slave.avf->nb_streams);
+    if (!slave.drop_until_keyframe)
+        return 1;
+    ret = av_thread_message_queue_alloc(&slave.queue, QUEUE_SIZE, sizeof(TeeMessage));
+    if (ret < 0)
+        return 1;
+    av_thread_message_queue_set_free_func(slave.queue, free_message);
+
+    /* V is a video keyframe, v a video delta frame, a an audio frame */
+    queue(avf, &slave, "V0");
+    queue(avf, &slave, "a0");
+    queue(avf, &slave, "v1");
+    queue(avf, &slave, "a1");   /* queue full */
+    queue(avf, &slave, "v2");   /* queue full */
+    drain(&slave);
+    queue(avf, &slave, "a2");
+    queue(avf, &slave, "v3");
+    queue(avf, &slave, "a3");
+    drain(&slave);
+    queue(avf, &slave, "V4");
+    queue(avf, &slave, "a4");
+    queue(avf, &slave, "v5");
+    drain(&slave);
+    printf("dropped: %"PRId64"\n", slave.nb_dropped);
+
+    av_thread_message_queue_free(&slave.queue);
+    av_freep(&slave.drop_until_keyframe);
+    avformat_free_context(slave.avf);
+    avformat_free_context(avf);
+    return 0;
+}
@@ -26,6 +26,7 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() with glibc */
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -70,6 +71,10 @@
 #include "libavutil/thread.h"
 #endif
 
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+#include <netinet/udp.h>
+#endif
+
 #ifndef IPV6_ADD_MEMBERSHIP
 #define IPV6_ADD_MEMBERSHIP IPV6_JOIN_GROUP
 #define IPV6_DROP_MEMBERSHIP IPV6_LEAVE_GROUP
@@ -79,6 +84,8 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_GSO_MAX_SIZE 65507
+#define UDP_GSO_MAX_SEGMENTS 64
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -109,6 +116,22 @@ typedef struct UDPContext {
     pthread_cond_t cond;
     int thread_started;
 #endif
+
+    /* Batched I/O for the circular buffer threads */
+    int batch_size;
+    int gro;
+    int gso;
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
+    struct sockaddr_storage *msg_addrs;
+    uint8_t *msg_ctrl;
+    int msg_ctrl_size;
+    uint8_t *batch_buf;
+    int batch_buf_size;
+    int batch_slot_size;    ///< bytes received per datagram (GRO message)
+    int batch_truncated;
+#endif
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
     char *localaddr;
@@ -138,6 +161,9 @@ static const AVOption options[] = {
     { "connect",        "set if connect() should be called on socket",     OFFSET(is_connected),   AV_OPT_TYPE_BOOL,   { .i64 =  0 },     0, 1,       .flags = D|E },
     { "fifo_size",      "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
     { "overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,    D },
+    { "batch_size",     "Max number of datagrams per system call in the circular buffer thread", OFFSET(batch_size), AV_OPT_TYPE_INT, { .i64 = 16 }, 1, 1024, D|E },
+    { "gro",            "Enable UDP generic receive offload (Linux only)", OFFSET(gro),            AV_OPT_TYPE_BOOL,   { .i64 = 0  },     0, 1,       D },
+    { "gso",            "Enable UDP generic segmentation offload (Linux only)", OFFSET(gso),       AV_OPT_TYPE_BOOL,   { .i64 = 0  },     0, 1,       E },
     { "timeout",        "set raise error timeout (only in read mode)",     OFFSET(timeout),        AV_OPT_TYPE_INT,    { .i64 = 0 },      0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -460,6 +486,105 @@ static int udp_get_file_handle(URLContext *h)
 }
 
 #if HAVE_PTHREAD_CANCEL
+/* Must be called with s->mutex held. Returns 1 if the datagram has to be
+ * dropped, a negative error code if the thread must stop, 0 otherwise. */
+static int check_fifo_space(URLContext *h, int len)
+{
+    UDPContext *s = h->priv_data;
+
+    if(av_fifo_space(s->fifo) < len + 4) {
+        /* No Space left */
+        if (s->overrun_nonfatal) {
+            av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                    "Surviving due to overrun_nonfatal option\n");
+            return 1;
+        } else {
+            av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                    "To avoid, increase fifo_size URL option. "
+                    "To survive in such case, use overrun_nonfatal option\n");
+            return AVERROR(EIO);
+        }
+    }
+    return 0;
+}
+
+#if HAVE_RECVMMSG
+static int recv_batch(UDPContext *s)
+{
+    int i;
+
+    for (i = 0; i < s->batch_size; i++) {
+        struct msghdr *msg = &s->msgs[i].msg_hdr;
+
+        s->iovs[i].iov_base = s->batch_buf + i * s->batch_slot_size;
+        s->iovs[i].iov_len  = s->batch_slot_size;
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_name    = &s->msg_addrs[i];
+        msg->msg_namelen = sizeof(s->msg_addrs[i]);
+        msg->msg_iov     = &s->iovs[i];
+        msg->msg_iovlen  = 1;
+        if (s->gro) {
+            msg->msg_control    = s->msg_ctrl + i * s->msg_ctrl_size;
+            msg->msg_controllen = s->msg_ctrl_size;
+        }
+    }
+    /* Block for the first datagram only, then take whatever is queued. */
+    return recvmmsg(s->udp_fd, s->msgs, s->batch_size, MSG_WAITFORONE, NULL);
+}
+
+/* Split a received (possibly GRO coalesced) message into datagrams and
+ * queue them. Must be called with s->mutex held. */
+static int queue_msg(URLContext *h, struct mmsghdr *mmsg)
+{
+    UDPContext *s = h->priv_data;
+    struct msghdr *msg = &mmsg->msg_hdr;
+    const uint8_t *buf = msg->msg_iov->iov_base;
+    int len = mmsg->msg_len;
+    int seg_size = len;
+    int ret;
+
+    if (ff_ip_check_source_lists(msg->msg_name, &s->filters))
+        return 0;
+    if ((msg->msg_flags & MSG_TRUNC) && !s->batch_truncated) {
+        av_log(h, AV_LOG_WARNING, "Datagram larger than pkt_size (%d bytes) "
+               "truncated, increase pkt_size\n", s->batch_slot_size);
+        s->batch_truncated = 1;
+    }
+
+#ifdef UDP_GRO
+    if (s->gro) {
+        struct cmsghdr *cmsg;
+        for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                int gso_size;
+                memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+                if (gso_size > 0)
+                    seg_size = gso_size;
+            }
+        }
+    }
+#endif
+
+    do {
+        uint8_t tmp[4];
+        int size = FFMIN(len, seg_size);
+
+        ret = check_fifo_space(h, size);
+        if (ret < 0)
+            return ret;
+        if (!ret) {
+            AV_WL32(tmp, size);
+            av_fifo_generic_write(s->fifo, tmp, 4, NULL);
+            av_fifo_generic_write(s->fifo, (uint8_t *)buf, size, NULL);
+        }
+        buf += size;
+        len -= size;
+    } while (len > 0);
+
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_rx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -474,7 +599,7 @@ static void *circular_buffer_task_rx( void *_URLContext)
         goto end;
     }
     while(1) {
-        int len;
+        int len, ret;
         struct sockaddr_storage addr;
         socklen_t addr_len = sizeof(addr);
 
@@ -483,6 +608,11 @@ static void *circular_buffer_task_rx( void *_URLContext)
            see "General Information" / "Thread Cancelation Overview"
            in Single Unix. */
         pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+#if HAVE_RECVMMSG
+        if (s->msgs)
+            len = recv_batch(s);
+        else
+#endif
         len = recvfrom(s->udp_fd, s->tmp+4, sizeof(s->tmp)-4, 0, (struct sockaddr *)&addr, &addr_len);
         pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
         pthread_mutex_lock(&s->mutex);
@@ -493,23 +623,28 @@ static void *circular_buffer_task_rx( void *_URLContext)
             }
             continue;
         }
+#if HAVE_RECVMMSG
+        if (s->msgs) {
+            int i;
+            for (i = 0; i < len; i++) {
+                if ((ret = queue_msg(h, &s->msgs[i])) < 0) {
+                    s->circular_buffer_error = ret;
+                    goto end;
+                }
+            }
+            pthread_cond_signal(&s->cond);
+            continue;
+        }
+#endif
         if (ff_ip_check_source_lists(&addr, &s->filters))
             continue;
         AV_WL32(s->tmp, len);
 
-        if(av_fifo_space(s->fifo) < len + 4) {
-            /* No Space left */
-            if (s->overrun_nonfatal) {
-                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
-                        "Surviving due to overrun_nonfatal option\n");
+        if ((ret = check_fifo_space(h, len))) {
+            if (ret > 0)
                 continue;
-            } else {
-                av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
-                        "To avoid, increase fifo_size URL option. "
-                        "To survive in such case, use overrun_nonfatal option\n");
-                s->circular_buffer_error = AVERROR(EIO);
-                goto end;
-            }
+            s->circular_buffer_error = ret;
+            goto end;
         }
         av_fifo_generic_write(s->fifo, s->tmp, len+4, NULL);
         pthread_cond_signal(&s->cond);
@@ -521,6 +656,108 @@ end:
     return NULL;
 }
 
+#if HAVE_SENDMMSG
+/* Pull further queued datagrams behind the one already in batch_buf, as long
+ * as they start within due_bits after it, i.e. as long as the per datagram
+ * pacing would have sent them right away. Must be called with s->mutex held.
+ * Returns the number of datagrams, *total is updated to their size. */
+static int gather_batch(UDPContext *s, int *total, int64_t due_bits)
+{
+    int nb_msgs = 1, seg_size = *total;
+
+    s->iovs[0].iov_base = s->batch_buf;
+    s->iovs[0].iov_len  = *total;
+    while (nb_msgs < s->batch_size && av_fifo_size(s->fifo) >= 4) {
+        uint8_t tmp[4];
+        int len;
+
+        av_fifo_generic_peek(s->fifo, tmp, 4, NULL);
+        len = AV_RL32(tmp);
+        if ((int64_t)(*total - seg_size) * 8 > due_bits ||
+            *total + len > s->batch_buf_size)
+            break;
+        /* With segmentation offload all datagrams but the last must have
+         * the size of the first one. */
+        if (s->gso && (nb_msgs >= UDP_GSO_MAX_SEGMENTS || !len || len > seg_size ||
+                       s->iovs[nb_msgs - 1].iov_len != seg_size ||
+                       *total + len > UDP_GSO_MAX_SIZE))
+            break;
+        av_fifo_drain(s->fifo, 4);
+        av_fifo_generic_read(s->fifo, s->batch_buf + *total, len, NULL);
+        s->iovs[nb_msgs].iov_base = s->batch_buf + *total;
+        s->iovs[nb_msgs].iov_len  = len;
+        *total += len;
+        nb_msgs++;
+    }
+    return nb_msgs;
+}
+
+static int send_batch(URLContext *h, int nb_msgs)
+{
+    UDPContext *s = h->priv_data;
+    int i, ret, sent = 0;
+
+#ifdef UDP_SEGMENT
+    if (s->gso) {
+        union {
+            char buf[CMSG_SPACE(sizeof(uint16_t))];
+            struct cmsghdr align;
+        } ctrl;
+        struct msghdr msg = { 0 };
+        struct cmsghdr *cmsg;
+        uint16_t gso_size = s->iovs[0].iov_len;
+
+        if (!s->is_connected) {
+            msg.msg_name    = &s->dest_addr;
+            msg.msg_namelen = s->dest_addr_len;
+        }
+        msg.msg_iov        = s->iovs;
+        msg.msg_iovlen     = nb_msgs;
+        msg.msg_control    = ctrl.buf;
+        msg.msg_controllen = sizeof(ctrl.buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_UDP;
+        cmsg->cmsg_type  = UDP_SEGMENT;
+        cmsg->cmsg_len   = CMSG_LEN(sizeof(gso_size));
+        memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+
+        do {
+            ret = sendmsg(s->udp_fd, &msg, 0) < 0 ? ff_neterrno() : 0;
+        } while (ret == AVERROR(EAGAIN) || ret == AVERROR(EINTR));
+        if (!ret)
+            return 0;
+        if (ret != AVERROR(EIO) && ret != AVERROR(EINVAL) && ret != AVERROR(ENOPROTOOPT))
+            return ret;
+        av_log(h, AV_LOG_WARNING, "UDP segmentation offload failed, disabling it\n");
+        s->gso = 0;
+    }
+#endif
+
+    for (i = 0; i < nb_msgs; i++) {
+        struct msghdr *msg = &s->msgs[i].msg_hdr;
+
+        memset(msg, 0, sizeof(*msg));
+        if (!s->is_connected) {
+            msg->msg_name    = &s->dest_addr;
+            msg->msg_namelen = s->dest_addr_len;
+        }
+        msg->msg_iov    = &s->iovs[i];
+        msg->msg_iovlen = 1;
+    }
+    while (sent < nb_msgs) {
+        ret = sendmmsg(s->udp_fd, s->msgs + sent, nb_msgs - sent, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret != AVERROR(EAGAIN) && ret != AVERROR(EINTR))
+                return ret;
+            continue;
+        }
+        sent += ret;
+    }
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_tx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -544,6 +781,9 @@ static void *circular_buffer_task_tx( void *_URLContext)
         const uint8_t *p;
         uint8_t tmp[4];
         int64_t timestamp;
+#if HAVE_SENDMMSG
+        int nb_msgs = 1;
+#endif
 
         len=av_fifo_size(s->fifo);
 
@@ -562,6 +802,11 @@ static void *circular_buffer_task_tx( void *_URLContext)
         av_assert0(len >= 0);
         av_assert0(len <= sizeof(s->tmp));
 
+#if HAVE_SENDMMSG
+        if (s->msgs)
+            av_fifo_generic_read(s->fifo, s->batch_buf, len, NULL);
+        else
+#endif
         av_fifo_generic_read(s->fifo, s->tmp, len, NULL);
 
         pthread_mutex_unlock(&s->mutex);
@@ -586,6 +831,35 @@ static void *circular_buffer_task_tx( void *_URLContext)
             target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
         }
 
+#if HAVE_SENDMMSG
+        if (s->msgs) {
+            int64_t due_bits = INT64_MAX;
+            int ret, first_len = len;
+
+            /* Add the datagrams which are already due, so the batch never
+             * goes out earlier than the datagrams would one by one. */
+            if (s->bitrate)
+                due_bits = (av_gettime_relative() - start_timestamp) * s->bitrate / 1000000 - sent_bits;
+            pthread_mutex_lock(&s->mutex);
+            nb_msgs = gather_batch(s, &len, due_bits);
+            pthread_mutex_unlock(&s->mutex);
+            if (s->bitrate) {
+                sent_bits += (len - first_len) * 8;
+                target_timestamp = start_timestamp + sent_bits * 1000000 / s->bitrate;
+            }
+
+            ret = send_batch(h, nb_msgs);
+            if (ret < 0) {
+                pthread_mutex_lock(&s->mutex);
+                s->circular_buffer_error = ret;
+                pthread_mutex_unlock(&s->mutex);
+                return NULL;
+            }
+            pthread_mutex_lock(&s->mutex);
+            continue;
+        }
+#endif
+
         p = s->tmp;
         while (len) {
             int ret;
@@ -618,9 +892,74 @@ end:
     return NULL;
 }
 
+static int alloc_batch(URLContext *h, int is_output)
+{
+    UDPContext *s = h->priv_data;
 
+#if HAVE_RECVMMSG
+    /* Plain recvfrom() is as good for single datagrams, except with GRO
+     * which needs the control messages. */
+    if (!is_output && (s->batch_size > 1 || s->gro)) {
+#ifdef UDP_GRO
+        if (s->gro && setsockopt(s->udp_fd, SOL_UDP, UDP_GRO, &s->gro, sizeof(s->gro)) < 0) {
+            ff_log_net_error(h, AV_LOG_WARNING, "setsockopt(UDP_GRO)");
+            s->gro = 0;
+        }
+#endif
+        s->msg_ctrl_size  = CMSG_SPACE(sizeof(int));
+        s->msg_ctrl       = av_malloc_array(s->batch_size, s->msg_ctrl_size);
+        s->msg_addrs      = av_malloc_array(s->batch_size, sizeof(*s->msg_addrs));
+        if (!s->msg_ctrl || !s->msg_addrs)
+            return AVERROR(ENOMEM);
+        /* GRO coalesces several datagrams into one message */
+        s->batch_slot_size = s->gro || s->pkt_size <= 0 ? UDP_MAX_PKT_SIZE :
+                             FFMIN(s->pkt_size, UDP_MAX_PKT_SIZE);
+        s->batch_buf_size  = s->batch_size * s->batch_slot_size;
+    }
+#endif
+#if HAVE_SENDMMSG
+    /* Without a burst allowance every datagram is paced on its own. */
+    if (is_output && s->batch_size > 1 && s->burst_bits)
+        s->batch_buf_size = FFMAX(s->batch_size * h->max_packet_size, sizeof(s->tmp));
+#endif
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    if (s->batch_buf_size) {
+        s->msgs      = av_mallocz_array(s->batch_size, sizeof(*s->msgs));
+        s->iovs      = av_malloc_array(s->batch_size, sizeof(*s->iovs));
+        s->batch_buf = av_malloc(s->batch_buf_size);
+        if (!s->msgs || !s->iovs || !s->batch_buf)
+            return AVERROR(ENOMEM);
+    }
+#endif
+#if !HAVE_RECVMMSG || !defined(UDP_GRO)
+    if (s->gro) {
+        av_log(h, AV_LOG_WARNING, "'gro' option was set but it is not supported "
+               "on this build\n");
+        s->gro = 0;
+    }
+#endif
+#if !HAVE_SENDMMSG || !defined(UDP_SEGMENT)
+    if (s->gso) {
+        av_log(h, AV_LOG_WARNING, "'gso' option was set but it is not supported "
+               "on this build\n");
+        s->gso = 0;
+    }
+#endif
+    return 0;
+}
 #endif
 
+static void free_batch(UDPContext *s)
+{
+#if HAVE_RECVMMSG || HAVE_SENDMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iovs);
+    av_freep(&s->msg_addrs);
+    av_freep(&s->msg_ctrl);
+    av_freep(&s->batch_buf);
+#endif
+}
+
 /* put it in UDP context */
 /* return non zero if error */
 static int udp_open(URLContext *h, const char *uri, int flags)
@@ -708,6 +1047,13 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         if (av_find_info_tag(buf, sizeof(buf), "burst_bits", p)) {
             s->burst_bits = strtoll(buf, NULL, 10);
         }
+        if (av_find_info_tag(buf, sizeof(buf), "batch_size", p)) {
+            s->batch_size = av_clip(strtol(buf, NULL, 10), 1, 1024);
+        }
+        if (!is_output && av_find_info_tag(buf, sizeof(buf), "gro", p))
+            s->gro = strtol(buf, NULL, 10);
+        if (is_output && av_find_info_tag(buf, sizeof(buf), "gso", p))
+            s->gso = strtol(buf, NULL, 10);
         if (av_find_info_tag(buf, sizeof(buf), "localaddr", p)) {
             av_strlcpy(localaddr, buf, sizeof(localaddr));
         }
@@ -892,6 +1238,8 @@ static int udp_open(URLContext *h, const char *uri, int flags)
 
         /* start the task going */
         s->fifo = av_fifo_alloc(s->circular_buffer_size);
+        if (alloc_batch(h, is_output) < 0)
+            goto fail;
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -922,6 +1270,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+    free_batch(s);
     ff_ip_reset_filters(&s->filters);
     return AVERROR(EIO);
 }
@@ -1091,6 +1440,7 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+    free_batch(s);
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
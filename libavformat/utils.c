@@ -3542,6 +3542,17 @@ static int add_coded_side_data(AVStream *st, AVCodecContext *avctx)
     return 0;
 }
 
+/* remember how much probing it took to know the codec parameters of st */
+static void update_probe_stats(AVStream *st, int64_t start_time)
+{
+    if (st->internal->probe_params_found || !has_codec_parameters(st, NULL))
+        return;
+    st->internal->probe_params_found = 1;
+    st->internal->probe_nb_packets   = st->codec_info_nb_frames;
+    st->internal->probe_nb_decoded   = st->nb_decoded_frames;
+    st->internal->probe_time         = av_gettime_relative() - start_time;
+}
+
 int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
 {
     int i, count = 0, ret = 0, j;
@@ -3559,6 +3570,8 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
     int64_t probesize = ic->probesize;
     int eof_reached = 0;
     int *missing_streams = av_opt_ptr(ic->iformat->priv_class, ic->priv_data, "missing_streams");
+    int fast_probe = ic->flags & AVFMT_FLAG_FAST_PROBE;
+    int64_t start_time = av_gettime_relative();
 
     flush_codecs = probesize > 0;
 
@@ -3574,6 +3587,10 @@ int avformat_find_stream_info(AVFormatContext *ic, AVDictionary **options)
             max_stream_analyze_duration = 90*AV_TIME_BASE;
         if (!strcmp(ic->iformat->name, "mpeg") || !strcmp(ic->iformat->name, "mpegts"))
             max_stream_analyze_duration = 7*AV_TIME_BASE;
+        /* once all the streams are known, only look a little further for
+         * late streams in formats without a header */
+        if (fast_probe)
+            max_analyze_duration = AV_TIME_BASE / 2;
     }
 
     if (ic->pb)
@@ -3663,6 +3680,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 #endif
         ic->streams[i]->info->fps_first_dts = AV_NOPTS_VALUE;
         ic->streams[i]->info->fps_last_dts  = AV_NOPTS_VALUE;
+        update_probe_stats(ic->streams[i], start_time);
     }
 
     read_size = 0;
@@ -3698,6 +3716,11 @@ FF_ENABLE_DEPRECATION_WARNINGS
             count = (ic->iformat->flags & AVFMT_NOTIMESTAMPS) ?
                        st->info->codec_info_duration_fields/2 :
                        st->info->duration_count;
+            /* in fast probe mode, any frame rate signalled by the container
+             * or the bitstream headers is good enough */
+            if (fast_probe && (st->r_frame_rate.num || st->avg_frame_rate.num ||
+                               st->internal->avctx->framerate.num))
+                fps_analyze_framecount = 0;
             if (!(st->r_frame_rate.num && st->avg_frame_rate.num) &&
                 st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
                 if (count < fps_analyze_framecount)
@@ -3880,15 +3903,20 @@ FF_ENABLE_DEPRECATION_WARNINGS
          * If AV_CODEC_CAP_CHANNEL_CONF is set this will force decoding of at
          * least one frame of codec data, this makes sure the codec initializes
          * the channel configuration and does not only trust the values from
-         * the container. */
-        try_decode_frame(ic, st, pkt,
-                         (options && i < orig_nb_streams) ? &options[i] : NULL);
+         * the container.
+         *
+         * In fast probe mode, decoding only happens as long as the container
+         * and the parser did not provide the parameters. */
+        if (!fast_probe || !has_codec_parameters(st, NULL))
+            try_decode_frame(ic, st, pkt,
+                             (options && i < orig_nb_streams) ? &options[i] : NULL);
 
         if (ic->flags & AVFMT_FLAG_NOBUFFER)
             av_packet_unref(&pkt1);
 
         st->codec_info_nb_frames++;
         count++;
+        update_probe_stats(st, start_time);
     }
 
     if (eof_reached) {
@@ -3939,6 +3967,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
                         "decoding for stream %d failed\n", st->index);
                 }
             }
+            update_probe_stats(st, start_time);
         }
     }
 
@@ -4137,6 +4166,15 @@ FF_ENABLE_DEPRECATION_WARNINGS
 find_stream_info_err:
     for (i = 0; i < ic->nb_streams; i++) {
         st = ic->streams[i];
+        if (st->internal->probe_params_found)
+            av_log(ic, fast_probe ? AV_LOG_VERBOSE : AV_LOG_DEBUG,
+                   "Stream #%d: parameters found after %d packets, %d decoded frames, %.1f ms\n",
+                   i, st->internal->probe_nb_packets, st->internal->probe_nb_decoded,
+                   st->internal->probe_time / 1000.0);
+        else
+            av_log(ic, fast_probe ? AV_LOG_VERBOSE : AV_LOG_DEBUG,
+                   "Stream #%d: parameters not found after %d packets, %d decoded frames\n",
+                   i, st->codec_info_nb_frames, st->nb_decoded_frames);
         if (st->info)
             av_freep(&st->info->duration_error);
         avcodec_close(ic->streams[i]->internal->avctx);
@@ -0,0 +1,176 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+
+#include "libavcodec/avcodec.h"
+
+#include "libavcodec/hevcdsp.h"
+
+#include "checkasm.h"
+
+static const uint32_t pixel_mask[3] = { 0xffffffff, 0x03ff03ff, 0x0fff0fff };
+static const int sizes[10] = { 2, 4, 6, 8, 12, 16, 24, 32, 48, 64 };
+
+#define SRC_STRIDE ((MAX_PB_SIZE + 16) * 2)
+#define SRC_BUF_SIZE (SRC_STRIDE * (MAX_PB_SIZE + 8) + 64) // + overread
+#define SRC_OFFSET (3 * SRC_STRIDE + 8) // room for the filter taps
+#define DST_STRIDE (MAX_PB_SIZE * 2)
+#define DST_BUF_SIZE (DST_STRIDE * MAX_PB_SIZE)
+
+#define randomize_buffers(buf, size)                        \
+    do {                                                    \
+        uint32_t mask = pixel_mask[(bit_depth - 8) >> 1];   \
+        int k;                                              \
+        for (k = 0; k < size; k += 4) {                     \
+            uint32_t r = rnd() & mask;                      \
+            AV_WN32A(buf + k, r);                           \
+        }                                                   \
+    } while (0)
+
+/* Weights and offsets in the ranges allowed by the pred_weight_table syntax */
+#define rnd_weight(denom) ((1 << (denom)) + (int)(rnd() % 256) - 128)
+#define rnd_offset()      (((int)(rnd() % 256) - 128) * (1 << (bit_depth - 8)))
+
+static void check_pel_uni_w(HEVCDSPContext *h, int bit_depth, int qpel)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    const char *type = qpel ? "qpel" : "epel";
+    int i, j, k;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int height, int denom, int wx, int ox, intptr_t mx, intptr_t my, int width);
+
+    randomize_buffers(src, SRC_BUF_SIZE);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        int size = sizes[i];
+
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 2; k++) {
+                intptr_t mx = k ? 1 + rnd() % (qpel ? 3 : 7) : 0;
+                intptr_t my = j ? 1 + rnd() % (qpel ? 3 : 7) : 0;
+                void (*func)(uint8_t *, ptrdiff_t, uint8_t *, ptrdiff_t, int, int, int, int,
+                             intptr_t, intptr_t, int) =
+                    qpel ? h->put_hevc_qpel_uni_w[i][j][k] : h->put_hevc_epel_uni_w[i][j][k];
+
+                if (check_func(func, "hevc_%s_uni_w_%s%s%d_%d", type,
+                               j ? "v" : "", k ? "h" : "", size, bit_depth)) {
+                    int denom = rnd() % 8;
+                    int wx    = rnd_weight(denom);
+                    int ox    = rnd_offset();
+
+                    memset(dst0, 0, DST_BUF_SIZE);
+                    memset(dst1, 0, DST_BUF_SIZE);
+                    call_ref(dst0, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE,
+                             size, denom, wx, ox, mx, my, size);
+                    call_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE,
+                             size, denom, wx, ox, mx, my, size);
+                    if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                        fail();
+                    bench_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE,
+                              size, denom, wx, ox, mx, my, size);
+                }
+            }
+        }
+    }
+}
+
+static void check_pel_bi_w(HEVCDSPContext *h, int bit_depth, int qpel)
+{
+    LOCAL_ALIGNED_32(uint8_t, src, [SRC_BUF_SIZE]);
+    LOCAL_ALIGNED_32(int16_t, src2, [MAX_PB_SIZE * MAX_PB_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst0, [DST_BUF_SIZE]);
+    LOCAL_ALIGNED_32(uint8_t, dst1, [DST_BUF_SIZE]);
+    const char *type = qpel ? "qpel" : "epel";
+    int i, j, k;
+
+    declare_func(void, uint8_t *dst, ptrdiff_t dststride, uint8_t *src, ptrdiff_t srcstride,
+                 int16_t *src2, int height, int denom, int wx0, int wx1, int ox0, int ox1,
+                 intptr_t mx, intptr_t my, int width);
+
+    randomize_buffers(src, SRC_BUF_SIZE);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(sizes); i++) {
+        int size = sizes[i];
+
+        for (j = 0; j < 2; j++) {
+            for (k = 0; k < 2; k++) {
+                intptr_t mx = k ? 1 + rnd() % (qpel ? 3 : 7) : 0;
+                intptr_t my = j ? 1 + rnd() % (qpel ? 3 : 7) : 0;
+                void (*func)(uint8_t *, ptrdiff_t, uint8_t *, ptrdiff_t, int16_t *, int, int,
+                             int, int, int, int, intptr_t, intptr_t, int) =
+                    qpel ? h->put_hevc_qpel_bi_w[i][j][k] : h->put_hevc_epel_bi_w[i][j][k];
+
+                /* the second prediction as the decoder gets it, from the
+                 * 14-bit intermediate output of the interpolation filters */
+                if (qpel)
+                    h->put_hevc_qpel[i][j][k](src2, src + SRC_OFFSET + SRC_STRIDE,
+                                              SRC_STRIDE, size, mx, my, size);
+                else
+                    h->put_hevc_epel[i][j][k](src2, src + SRC_OFFSET + SRC_STRIDE,
+                                              SRC_STRIDE, size, mx, my, size);
+
+                if (check_func(func, "hevc_%s_bi_w_%s%s%d_%d", type,
+                               j ? "v" : "", k ? "h" : "", size, bit_depth)) {
+                    int denom = rnd() % 8;
+                    int wx0 = rnd_weight(denom), wx1 = rnd_weight(denom);
+                    int ox0 = rnd_offset(),      ox1 = rnd_offset();
+
+                    memset(dst0, 0, DST_BUF_SIZE);
+                    memset(dst1, 0, DST_BUF_SIZE);
+                    call_ref(dst0, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, src2,
+                             size, denom, wx0, wx1, ox0, ox1, mx, my, size);
+                    call_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, src2,
+                             size, denom, wx0, wx1, ox0, ox1, mx, my, size);
+                    if (memcmp(dst0, dst1, DST_BUF_SIZE))
+                        fail();
+                    bench_new(dst1, DST_STRIDE, src + SRC_OFFSET, SRC_STRIDE, src2,
+                              size, denom, wx0, wx1, ox0, ox1, mx, my, size);
+                }
+            }
+        }
+    }
+}
+
+void checkasm_check_hevc_pel(void)
+{
+    int bit_depth;
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_pel_uni_w(&h, bit_depth, 1);
+        check_pel_uni_w(&h, bit_depth, 0);
+    }
+    report("uni_w");
+
+    for (bit_depth = 8; bit_depth <= 12; bit_depth += 2) {
+        HEVCDSPContext h;
+
+        ff_hevc_dsp_init(&h, bit_depth);
+        check_pel_bi_w(&h, bit_depth, 1);
+        check_pel_bi_w(&h, bit_depth, 0);
+    }
+    report("bi_w");
+}
@@ -0,0 +1,127 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/vf_overlay.h"
+
+#define WIDTH 125
+#define WIDTH_PADDED (WIDTH + 32)
+
+#define FAST_DIV255(x) ((((x) + 128) * 257) >> 16)
+
+#define randomize_buffers(buf, size)     \
+    do {                                 \
+       int j;                            \
+       uint8_t *tmp_buf = (uint8_t *)buf;\
+       for (j = 0; j < size; j++)        \
+           tmp_buf[j] = rnd() & 0xFF;    \
+    } while (0)
+
+/* the straight alpha blend of blend_plane() for 8-bit planes */
+static int blend_row_c(uint8_t *d, uint8_t *s, uint8_t *a, int w,
+                       ptrdiff_t alinesize, int hsub, int vsub)
+{
+    int k;
+
+    for (k = 0; k < w; k++) {
+        int alpha_v, alpha_h, alpha;
+
+        if (hsub && vsub && k + 1 < w) {
+            alpha = (a[0] + a[alinesize] + a[1] + a[alinesize + 1]) >> 2;
+        } else if (hsub || vsub) {
+            alpha_h = hsub && k + 1 < w ? (a[0] + a[1]) >> 1 : a[0];
+            alpha_v = vsub ? (a[0] + a[alinesize]) >> 1 : a[0];
+            alpha = (alpha_v + alpha_h) >> 1;
+        } else
+            alpha = a[0];
+        d[k] = FAST_DIV255(d[k] * (255 - alpha) + s[k] * alpha);
+        a += 1 << hsub;
+    }
+    return w;
+}
+
+static int blend_row_44_c(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                          int w, ptrdiff_t alinesize)
+{
+    return blend_row_c(d, s, a, w, alinesize, 0, 0);
+}
+
+static int blend_row_20_c(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                          int w, ptrdiff_t alinesize)
+{
+    return blend_row_c(d, s, a, w, alinesize, 1, 1);
+}
+
+static int blend_row_22_c(uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                          int w, ptrdiff_t alinesize)
+{
+    return blend_row_c(d, s, a, w, alinesize, 1, 0);
+}
+
+static void check_blend_row(const char *name, int format, int pix_format,
+                            int plane, int hsub,
+                            int (*blend_row_ref)(uint8_t *d, uint8_t *da,
+                                                 uint8_t *s, uint8_t *a,
+                                                 int w, ptrdiff_t alinesize))
+{
+    LOCAL_ALIGNED_32(uint8_t, src,     [WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(uint8_t, alpha,   [WIDTH_PADDED * 4]);
+    LOCAL_ALIGNED_32(uint8_t, dst_ref, [WIDTH_PADDED]);
+    LOCAL_ALIGNED_32(uint8_t, dst_new, [WIDTH_PADDED]);
+    ptrdiff_t alinesize = WIDTH_PADDED * 2;
+    OverlayContext s = { 0 };
+    int c;
+
+    declare_func(int, uint8_t *d, uint8_t *da, uint8_t *s, uint8_t *a,
+                 int w, ptrdiff_t alinesize);
+
+    s.blend_row[plane] = blend_row_ref;
+    if (ARCH_X86)
+        ff_overlay_init_x86(&s, format, pix_format, 0, 0);
+
+    memset(src,     0, WIDTH_PADDED);
+    memset(alpha,   0, WIDTH_PADDED * 4);
+    memset(dst_ref, 0, WIDTH_PADDED);
+    randomize_buffers(src,     WIDTH);
+    randomize_buffers(alpha,   WIDTH_PADDED * 4);
+    randomize_buffers(dst_ref, WIDTH);
+    memcpy(dst_new, dst_ref, WIDTH_PADDED);
+
+    if (check_func(s.blend_row[plane], "overlay_row_%s", name)) {
+        call_ref(dst_ref, NULL, src, alpha, WIDTH, alinesize);
+        /* blend_plane() finishes the row in C after the SIMD part */
+        c = call_new(dst_new, NULL, src, alpha, WIDTH, alinesize);
+        if (c < 0 || c > WIDTH)
+            fail();
+        else
+            blend_row_ref(dst_new + c, NULL, src + c, alpha + (c << hsub),
+                          WIDTH - c, alinesize);
+        if (memcmp(dst_ref, dst_new, WIDTH_PADDED))
+            fail();
+        bench_new(dst_new, NULL, src, alpha, WIDTH, alinesize);
+    }
+}
+
+void checkasm_check_vf_overlay(void)
+{
+    check_blend_row("44", OVERLAY_FORMAT_YUV444, AV_PIX_FMT_YUV444P, 0, 0, blend_row_44_c);
+    check_blend_row("20", OVERLAY_FORMAT_YUV420, AV_PIX_FMT_YUV420P, 1, 1, blend_row_20_c);
+    check_blend_row("22", OVERLAY_FORMAT_YUV422, AV_PIX_FMT_YUV422P, 1, 1, blend_row_22_c);
+    report("blend_row");
+}
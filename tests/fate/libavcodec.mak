@@ -18,6 +18,19 @@ fate-codec_desc: libavcodec/tests/codec_desc$(EXESUF)
 fate-codec_desc: CMD = run libavcodec/tests/codec_desc$(EXESUF)
 fate-codec_desc: CMP = null
 
+FATE_LIBAVCODEC-$(CONFIG_GOLOMB) += fate-get_bits fate-get_bits_cached fate-get_bits_long
+fate-get_bits: libavcodec/tests/get_bits$(EXESUF)
+fate-get_bits: CMD = run libavcodec/tests/get_bits$(EXESUF)
+fate-get_bits: CMP = null
+
+fate-get_bits_cached: libavcodec/tests/get_bits_cached$(EXESUF)
+fate-get_bits_cached: CMD = run libavcodec/tests/get_bits_cached$(EXESUF)
+fate-get_bits_cached: CMP = null
+
+fate-get_bits_long: libavcodec/tests/get_bits_long$(EXESUF)
+fate-get_bits_long: CMD = run libavcodec/tests/get_bits_long$(EXESUF)
+fate-get_bits_long: CMP = null
+
 FATE_LIBAVCODEC-$(CONFIG_GOLOMB) += fate-golomb
 fate-golomb: libavcodec/tests/golomb$(EXESUF)
 fate-golomb: CMD = run libavcodec/tests/golomb$(EXESUF)
@@ -1,6 +1,12 @@
-#FATE_LIBAVFORMAT-$(HAVE_PTHREADS) += fate-async
-#fate-async: libavformat/tests/async$(EXESUF)
-#fate-async: CMD = run libavformat/tests/async
+FATE_ASYNC-$(CONFIG_DATA_PROTOCOL) += fate-async
+fate-async: libavformat/tests/async$(EXESUF)
+fate-async: CMD = run libavformat/tests/async$(EXESUF)
+FATE_LIBAVFORMAT-$(CONFIG_ASYNC_PROTOCOL) += $(FATE_ASYNC-yes)
+
+FATE_HTTPPOOL-$(HAVE_THREADS) += fate-httppool
+fate-httppool: libavformat/tests/httppool$(EXESUF)
+fate-httppool: CMD = run libavformat/tests/httppool$(EXESUF)
+FATE_LIBAVFORMAT-$(CONFIG_HTTP_PROTOCOL) += $(FATE_HTTPPOOL-yes)
 
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/tests/noproxy$(EXESUF)
@@ -10,10 +16,19 @@ FATE_LIBAVFORMAT-$(CONFIG_FFRTMPCRYPT_PROTOCOL) += fate-rtmpdh
 fate-rtmpdh: libavformat/tests/rtmpdh$(EXESUF)
 fate-rtmpdh: CMD = run libavformat/tests/rtmpdh$(EXESUF)
 
+FATE_TEE-$(HAVE_THREADS) += fate-tee-queue-overflow
+fate-tee-queue-overflow: libavformat/tests/tee$(EXESUF)
+fate-tee-queue-overflow: CMD = run libavformat/tests/tee$(EXESUF)
+FATE_LIBAVFORMAT-$(CONFIG_TEE_MUXER) += $(FATE_TEE-yes)
+
 FATE_LIBAVFORMAT-$(CONFIG_SRTP) += fate-srtp
 fate-srtp: libavformat/tests/srtp$(EXESUF)
 fate-srtp: CMD = run libavformat/tests/srtp$(EXESUF)
 
+FATE_LIBAVFORMAT-yes += fate-seekindex
+fate-seekindex: libavformat/tests/seekindex$(EXESUF)
+fate-seekindex: CMD = run libavformat/tests/seekindex$(EXESUF)
+
 FATE_LIBAVFORMAT-yes += fate-url
 fate-url: libavformat/tests/url$(EXESUF)
 fate-url: CMD = run libavformat/tests/url$(EXESUF)
@@ -0,0 +1,173 @@
+/*
+ * Video decoder throughput and latency benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+
+typedef struct BenchStats {
+    int64_t nb_frames;
+    int64_t latency_sum;
+    int64_t latency_max;
+} BenchStats;
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-threads n] [-thread_type type] [-o key=value[:key=value...]] <input>\n", argv0);
+    fprintf(stderr, "Decodes the first video stream of the input and reports the decoding\n"
+                    "speed and the latency of each frame, from the packet being sent to the\n"
+                    "decoder to the frame being returned. The packets are read in memory\n"
+                    "first, so that the demuxing is not measured.\n"
+                    "-o sets options of the decoder, e.g. -o substream_threads=4 for hevc.\n");
+    return ret;
+}
+
+static int receive_frames(AVCodecContext *dec, AVFrame *frame, BenchStats *stats)
+{
+    int ret;
+
+    while ((ret = avcodec_receive_frame(dec, frame)) >= 0) {
+        int64_t latency = av_gettime_relative() - frame->reordered_opaque;
+
+        stats->nb_frames++;
+        stats->latency_sum += latency;
+        stats->latency_max  = FFMAX(stats->latency_max, latency);
+        av_frame_unref(frame);
+    }
+    return ret == AVERROR(EAGAIN) || ret == AVERROR_EOF ? 0 : ret;
+}
+
+int main(int argc, char **argv)
+{
+    const char *filename = NULL;
+    AVFormatContext *ic = NULL;
+    AVCodecContext *dec = NULL;
+    AVDictionary *opts = NULL;
+    AVCodec *codec;
+    AVFrame *frame = NULL;
+    AVPacket pkt, *pkts = NULL;
+    BenchStats stats = { 0 };
+    int nb_pkts = 0, stream_idx, ret = 0, i;
+    int64_t start_time, elapsed;
+    char errbuf[50];
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-threads") && i + 1 < argc) {
+            av_dict_set(&opts, "threads", argv[++i], 0);
+        } else if (!strcmp(argv[i], "-thread_type") && i + 1 < argc) {
+            av_dict_set(&opts, "thread_type", argv[++i], 0);
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            ret = av_dict_parse_string(&opts, argv[++i], "=", ":", 0);
+            if (ret < 0)
+                goto fail;
+        } else if (!filename) {
+            filename = argv[i];
+        } else {
+            av_dict_free(&opts);
+            return usage(argv[0], 1);
+        }
+    }
+    if (!filename) {
+        av_dict_free(&opts);
+        return usage(argv[0], 1);
+    }
+
+    ret = avformat_open_input(&ic, filename, NULL, NULL);
+    if (ret < 0)
+        goto fail;
+    ret = avformat_find_stream_info(ic, NULL);
+    if (ret < 0)
+        goto fail;
+    ret = stream_idx = av_find_best_stream(ic, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+    if (ret < 0)
+        goto fail;
+
+    dec = avcodec_alloc_context3(codec);
+    frame = av_frame_alloc();
+    if (!dec || !frame) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+    ret = avcodec_parameters_to_context(dec, ic->streams[stream_idx]->codecpar);
+    if (ret < 0)
+        goto fail;
+    ret = avcodec_open2(dec, codec, &opts);
+    if (ret < 0)
+        goto fail;
+    if (av_dict_count(opts)) {
+        fprintf(stderr, "Unknown decoder option '%s'\n", av_dict_get(opts, "", NULL, AV_DICT_IGNORE_SUFFIX)->key);
+        ret = AVERROR_OPTION_NOT_FOUND;
+        goto fail;
+    }
+
+    while ((ret = av_read_frame(ic, &pkt)) >= 0) {
+        if (pkt.stream_index != stream_idx) {
+            av_packet_unref(&pkt);
+            continue;
+        }
+        ret = av_reallocp_array(&pkts, nb_pkts + 1, sizeof(*pkts));
+        if (ret < 0) {
+            av_packet_unref(&pkt);
+            goto fail;
+        }
+        pkts[nb_pkts++] = pkt;
+    }
+    if (ret != AVERROR_EOF)
+        goto fail;
+
+    start_time = av_gettime_relative();
+    for (i = 0; i <= nb_pkts; i++) {
+        dec->reordered_opaque = av_gettime_relative();
+        ret = avcodec_send_packet(dec, i < nb_pkts ? &pkts[i] : NULL);
+        if (ret < 0)
+            goto fail;
+        ret = receive_frames(dec, frame, &stats);
+        if (ret < 0)
+            goto fail;
+    }
+    elapsed = av_gettime_relative() - start_time;
+
+    printf("%"PRId64" frames in %.3f s: %.1f fps", stats.nb_frames, elapsed / 1000000.0,
+           elapsed > 0 ? stats.nb_frames * 1000000.0 / elapsed : 0.0);
+    if (stats.nb_frames)
+        printf(", latency avg %.2f ms max %.2f ms",
+               stats.latency_sum / 1000.0 / stats.nb_frames, stats.latency_max / 1000.0);
+    printf("\n");
+
+fail:
+    if (ret < 0) {
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        fprintf(stderr, "decode_bench: %s\n", errbuf);
+    }
+    for (i = 0; i < nb_pkts; i++)
+        av_packet_unref(&pkts[i]);
+    av_freep(&pkts);
+    av_dict_free(&opts);
+    av_frame_free(&frame);
+    avcodec_free_context(&dec);
+    avformat_close_input(&ic);
+    return ret < 0;
+}
@@ -0,0 +1,122 @@
+/*
+ * Demuxer throughput benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-p program_id] [-n runs] [-f format] <input>\n", argv0);
+    fprintf(stderr, "Reads all the packets of the input and reports the demuxing speed,\n"
+                    "including the stream probing, of the fastest of the runs.\n"
+                    "With -p, all the programs but the given one are discarded after probing,\n"
+                    "as when extracting a single service from a multiplex.\n");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    const char *filename = NULL, *format = NULL;
+    AVInputFormat *ifmt = NULL;
+    AVFormatContext *ic = NULL;
+    AVPacket pkt;
+    int program_id = -1, nb_runs = 1, run, ret = 0, i;
+    int64_t nb_packets, nb_bytes, start_time, best_time = INT64_MAX, size;
+    char errbuf[50];
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            program_id = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            nb_runs = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-f") && i + 1 < argc) {
+            format = argv[++i];
+        } else if (!filename) {
+            filename = argv[i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (!filename || nb_runs <= 0)
+        return usage(argv[0], 1);
+
+    if (format && !(ifmt = av_find_input_format(format))) {
+        fprintf(stderr, "Unknown input format '%s'\n", format);
+        return 1;
+    }
+
+    for (run = 0; run < nb_runs; run++) {
+        nb_packets = nb_bytes = 0;
+        start_time = av_gettime_relative();
+        ret = avformat_open_input(&ic, filename, ifmt, NULL);
+        if (ret < 0)
+            goto fail;
+        ret = avformat_find_stream_info(ic, NULL);
+        if (ret < 0)
+            goto fail;
+
+        if (program_id >= 0) {
+            int found = 0;
+            for (i = 0; i < ic->nb_programs; i++) {
+                AVProgram *program = ic->programs[i];
+                if (program->id == program_id)
+                    found = 1;
+                else
+                    program->discard = AVDISCARD_ALL;
+            }
+            if (!found) {
+                fprintf(stderr, "Program %d not found\n", program_id);
+                ret = AVERROR(EINVAL);
+                goto fail;
+            }
+        }
+
+        while ((ret = av_read_frame(ic, &pkt)) >= 0) {
+            nb_packets++;
+            nb_bytes += pkt.size;
+            av_packet_unref(&pkt);
+        }
+        if (ret != AVERROR_EOF)
+            goto fail;
+        best_time = FFMIN(best_time, av_gettime_relative() - start_time);
+        size = ic->pb ? avio_size(ic->pb) : 0;
+
+        avformat_close_input(&ic);
+    }
+    ret = 0;
+
+    printf("%"PRId64" packets, %"PRId64" payload bytes in %.3f s", nb_packets, nb_bytes,
+           best_time / 1000000.0);
+    if (size > 0 && best_time > 0)
+        printf(": %.1f MB/s of input", size / (double)best_time);
+    printf("\n");
+
+fail:
+    if (ret < 0) {
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        fprintf(stderr, "demux_bench: %s\n", errbuf);
+    }
+    avformat_close_input(&ic);
+    return ret < 0;
+}
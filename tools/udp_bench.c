@@ -0,0 +1,131 @@
+/*
+ * UDP protocol loopback throughput benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+static int usage(const char *argv0, int ret)
+{
+    fprintf(stderr, "%s [-n packets] [-s size] [-p port] [-oi <options>] [-oo <options>]\n", argv0);
+    fprintf(stderr, "Sends packets of the given size over UDP on the loopback interface\n"
+                    "and reports the receive throughput.\n");
+    fprintf(stderr, "<options>: udp AVOptions expressed as key=value, :-separated,\n"
+                    "e.g. -oi batch_size=32:gro=1 -oo bitrate=1000000000:burst_bits=200000\n");
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int nb_packets = 100000, size = 1316, port = 12345, ret, i;
+    int64_t received = 0, start_time, end_time;
+    AVIOContext *input = NULL, *output = NULL;
+    AVDictionary *in_opts = NULL, *out_opts = NULL;
+    char url[256], errbuf[50];
+    uint8_t *buf;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            nb_packets = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            size = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-oi") && i + 1 < argc) {
+            if (av_dict_parse_string(&in_opts, argv[++i], "=", ":", 0) < 0)
+                return usage(argv[0], 1);
+        } else if (!strcmp(argv[i], "-oo") && i + 1 < argc) {
+            if (av_dict_parse_string(&out_opts, argv[++i], "=", ":", 0) < 0)
+                return usage(argv[0], 1);
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if (nb_packets <= 0 || size <= 0 || size > 65507)
+        return usage(argv[0], 1);
+
+    buf = av_mallocz(size);
+    if (!buf)
+        return 1;
+
+    avformat_network_init();
+
+    /* The receiving thread has to hold everything until it is read back. */
+    av_dict_set_int(&in_opts, "fifo_size", (int64_t)nb_packets * (size + 4) / 188 + 1, AV_DICT_DONT_OVERWRITE);
+    av_dict_set(&in_opts, "overrun_nonfatal", "1", AV_DICT_DONT_OVERWRITE);
+    av_dict_set(&in_opts, "timeout", "500000", AV_DICT_DONT_OVERWRITE);
+    av_dict_set_int(&in_opts, "buffer_size", 8 << 20, AV_DICT_DONT_OVERWRITE);
+    av_dict_set_int(&out_opts, "pkt_size", size, AV_DICT_DONT_OVERWRITE);
+    av_dict_set_int(&out_opts, "fifo_size", (int64_t)nb_packets * (size + 4) / 188 + 1, AV_DICT_DONT_OVERWRITE);
+
+    snprintf(url, sizeof(url), "udp://127.0.0.1:%d?localaddr=127.0.0.1", port);
+    ret = avio_open2(&input, url, AVIO_FLAG_READ, NULL, &in_opts);
+    if (ret < 0)
+        goto fail;
+    snprintf(url, sizeof(url), "udp://127.0.0.1:%d", port);
+    ret = avio_open2(&output, url, AVIO_FLAG_WRITE, NULL, &out_opts);
+    if (ret < 0)
+        goto fail;
+
+    start_time = av_gettime_relative();
+    for (i = 0; i < nb_packets; i++) {
+        AV_WB32(buf, i);
+        avio_write(output, buf, size);
+        avio_flush(output);
+        if (output->error) {
+            ret = output->error;
+            goto fail;
+        }
+    }
+    avio_closep(&output);
+
+    end_time = start_time;
+    while (received < (int64_t)nb_packets * size) {
+        int n = avio_read_partial(input, buf, size);
+        if (n <= 0)
+            break;
+        received += n;
+        end_time = av_gettime_relative();
+    }
+
+    printf("sent %d packets of %d bytes, received %"PRId64" (%"PRId64" lost) in %.3f s: %.1f Mbit/s\n",
+           nb_packets, size, received / size, nb_packets - received / size,
+           (end_time - start_time) / 1000000.0,
+           end_time > start_time ? received * 8.0 / (end_time - start_time) : 0.0);
+    ret = 0;
+
+fail:
+    if (ret < 0) {
+        av_strerror(ret, errbuf, sizeof(errbuf));
+        fprintf(stderr, "udp_bench: %s\n", errbuf);
+    }
+    avio_closep(&output);
+    avio_closep(&input);
+    av_dict_free(&in_opts);
+    av_dict_free(&out_opts);
+    av_free(buf);
+    avformat_network_deinit();
+    return ret < 0;
+}